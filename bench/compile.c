@@ -0,0 +1,143 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <netuno/memory.h>
+#include <netuno/ntc.h>
+#include <netuno/path.h>
+#include <netuno/str.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Compiles the files given as one assembly and prints a CSV row per phase of ntCompile, with
+// its time, the allocations it made and the peak resident memory of the process once it is done.
+// The peak never goes down, so each size is best measured in a process of its own, as
+// bench/compile.py does.
+
+static const char *const PHASES[] = {"parse", "resolve", "gen"};
+
+typedef struct
+{
+    uint64_t start;
+    uint64_t allocations;
+    long peak;
+} PHASE_STATE;
+
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+// in KiB on Linux
+static long peakMemory(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void onPhase(NT_PHASE phase, bool done, void *userdata)
+{
+    PHASE_STATE *state = (PHASE_STATE *)userdata;
+    if (!done)
+    {
+        state->peak = peakMemory();
+        state->allocations = ntAllocations();
+        state->start = now();
+        return;
+    }
+
+    const uint64_t elapsed = now() - state->start;
+    const uint64_t allocations = ntAllocations() - state->allocations;
+    const long peak = peakMemory();
+    printf("%s,%.3f,%llu,%ld,%ld\n", PHASES[phase], elapsed / 1e6,
+           (unsigned long long)allocations, peak, peak - state->peak);
+}
+
+static char_t *readFile(const char *filepath)
+{
+    FILE *file = fopen(filepath, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const size_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *code = (char *)ntMalloc(size + 1);
+    const size_t read = fread(code, 1, size, file);
+    fclose(file);
+
+    char_t *codet = read == size ? ntToCharTFixed(code, size) : NULL;
+    ntFree(code);
+    return codet;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <file>...\n", argv[0]);
+        return 2;
+    }
+
+    const size_t count = argc - 1;
+    NT_FILE *files = (NT_FILE *)ntMalloc(sizeof(NT_FILE) * count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        char_t *code = readFile(argv[i + 1]);
+        if (code == NULL)
+        {
+            printf("Error: could not read %s\n", argv[i + 1]);
+            return 1;
+        }
+        char_t *source = ntToCharT(argv[i + 1]);
+        files[i] = (NT_FILE){
+            .code = code,
+            .source = source,
+            .filename = ntPathFilename(source, false),
+        };
+    }
+
+    printf("phase,ms,allocations,peak_kib,peak_growth_kib\n");
+    PHASE_STATE state = {0};
+    const long startPeak = peakMemory();
+    const uint64_t startAllocations = ntAllocations();
+    const uint64_t start = now();
+    NT_ASSEMBLY *assembly = ntCreateAssembly();
+    if (ntCompileObserved(assembly, count, files, onPhase, &state) != assembly)
+    {
+        ntFreeObject((NT_OBJECT *)assembly);
+        return 1;
+    }
+    const long peak = peakMemory();
+    printf("total,%.3f,%llu,%ld,%ld\n", (now() - start) / 1e6,
+           (unsigned long long)(ntAllocations() - startAllocations), peak, peak - startPeak);
+
+    ntFreeObject((NT_OBJECT *)assembly);
+    return 0;
+}
@@ -0,0 +1,94 @@
+import argparse, csv, io, os, subprocess, sys, tempfile
+
+# Generates programs of growing size and compiles each one with ntc-bench in a process of its
+# own, printing one CSV row per size and phase of ntCompile. A time per function that grows with
+# the size points at superlinear work in that phase.
+
+benchdir = os.path.dirname(os.path.abspath(__file__))
+rootdir = os.path.dirname(benchdir)
+
+
+# f<i> takes two ints, declares locals, a long string and nested blocks, and calls the function
+# at half its index, so every call resolves a symbol declared far away
+def function(i, locals, depth, stringLength):
+    lines = [f"def f{i}(a: int, b: int): int"]
+    lines.append(f"  var l0 = a + {i}")
+    for k in range(1, locals):
+        lines.append(f"  var l{k} = l{k - 1} * {k % 7 + 1} - b")
+
+    text = f"f{i} " + "abcdefghijklmnopqrstuvwxyz" * (stringLength // 26 + 1)
+    lines.append(f"  var s = \"{text[:stringLength]}\"")
+
+    indent = "  "
+    for level in range(depth):
+        local = f"l{level % locals}"
+        if level % 2 == 0:
+            lines.append(f"{indent}if {local} > {level}")
+        else:
+            lines.append(f"{indent}while {local} < {level * 3}")
+        indent += "  "
+        lines.append(f"{indent}{local} = {local} + 1")
+    for level in reversed(range(depth)):
+        indent = indent[:-2]
+        lines.append(f"{indent}next")
+
+    last = f"l{locals - 1}"
+    if i > 0:
+        lines.append(f"  return f{i // 2}({last} % 100, b) + {last}")
+    else:
+        lines.append(f"  return {last}")
+    lines.append("end")
+    return "\n".join(lines)
+
+
+def program(functions, locals, depth, stringLength):
+    parts = [function(i, locals, depth, stringLength) for i in range(functions)]
+    parts.append(f"def main(): int\n  f{functions - 1}(1, 2)\n  return 0\nend")
+    return "\n\n".join(parts) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--ntc-bench", default=os.path.join(rootdir, "bin", "ntc-bench"))
+    parser.add_argument("--sizes", default="1000,2000,4000", help="function counts")
+    parser.add_argument("--timeout", type=float, default=300,
+                        help="seconds a size may take, larger ones are skipped after it")
+    parser.add_argument("--locals", type=int, default=16)
+    parser.add_argument("--depth", type=int, default=8, help="nested blocks per function")
+    parser.add_argument("--string", type=int, default=256, help="length of each string literal")
+    parser.add_argument("--emit", type=int, metavar="FUNCTIONS",
+                        help="print the program with this many functions and stop")
+    args = parser.parse_args()
+
+    if args.emit:
+        sys.stdout.write(program(args.emit, args.locals, args.depth, args.string))
+        return
+
+    out = csv.writer(sys.stdout, lineterminator="\n")
+    out.writerow(["functions", "phase", "ms", "us_per_function", "allocations", "peak_kib",
+                  "peak_growth_kib"])
+    with tempfile.TemporaryDirectory() as tmp:
+        for size in (int(s) for s in args.sizes.split(",")):
+            path = os.path.join(tmp, f"generated{size}.nt")
+            with open(path, "w") as f:
+                f.write(program(size, args.locals, args.depth, args.string))
+
+            try:
+                proc = subprocess.run([args.ntc_bench, path], capture_output=True, text=True,
+                                      timeout=args.timeout)
+            except subprocess.TimeoutExpired:
+                out.writerow([size, "timeout", f"{args.timeout * 1000:.3f}", "", "", "", ""])
+                break
+            if proc.returncode != 0:
+                sys.stderr.write(proc.stdout + proc.stderr)
+                sys.exit(f"compiling {size} functions failed with {proc.returncode}")
+
+            for row in csv.DictReader(io.StringIO(proc.stdout)):
+                ms = float(row["ms"])
+                out.writerow([size, row["phase"], row["ms"], f"{ms * 1000 / size:.3f}",
+                              row["allocations"], row["peak_kib"], row["peak_growth_kib"]])
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,413 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <netuno/array.h>
+#include <netuno/assembly.h>
+#include <netuno/memory.h>
+#include <netuno/object.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <netuno/table.h>
+#include <netuno/varint.h>
+#include <netuno/vm.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Times the runtime primitives at several sizes and prints one CSV row per primitive and size,
+// with the nanoseconds and the ntMalloc/ntRealloc calls each operation took on average.
+
+// every measurement repeats its operation about this many times
+#define OPS (1 << 20)
+
+static const size_t COUNTS[] = {16, 256, 4096, 65536};
+static const size_t LENGTHS[] = {8, 64, 1024};
+#define COUNT_SIZES (sizeof(COUNTS) / sizeof(COUNTS[0]))
+#define LENGTH_SIZES (sizeof(LENGTHS) / sizeof(LENGTHS[0]))
+
+// results land here so the compiler cannot drop the work
+static volatile uint64_t sink;
+
+typedef struct
+{
+    uint64_t start;
+    uint64_t allocations;
+} MEASURE;
+
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+static void begin(MEASURE *measure)
+{
+    measure->allocations = ntAllocations();
+    measure->start = now();
+}
+
+static void end(const MEASURE *measure, const char *name, const size_t size, const size_t ops)
+{
+    const uint64_t elapsed = now() - measure->start;
+    const uint64_t allocations = ntAllocations() - measure->allocations;
+    printf("%s,%zu,%zu,%.2f,%.3f\n", name, size, ops, (double)elapsed / ops,
+           (double)allocations / ops);
+}
+
+static size_t rounds(const size_t count)
+{
+    return count < OPS ? OPS / count : 1;
+}
+
+// distinct keys of the same length, "k" followed by the index in base 26
+static const NT_STRING **makeKeys(const size_t count, const size_t length)
+{
+    const NT_STRING **keys = (const NT_STRING **)ntMalloc(sizeof(NT_STRING *) * count);
+    char_t *chars = (char_t *)ntMalloc(sizeof(char_t) * length);
+    for (size_t i = 0; i < count; ++i)
+    {
+        chars[0] = U'k';
+        size_t value = i;
+        for (size_t j = 1; j < length; ++j)
+        {
+            chars[j] = U'a' + value % 26;
+            value /= 26;
+        }
+        keys[i] = ntCopyString(chars, length);
+    }
+    ntFree(chars);
+    return keys;
+}
+
+static void freeKeys(const NT_STRING **keys, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        ntFreeObject((NT_OBJECT *)keys[i]);
+    ntFree(keys);
+}
+
+static void benchTable(void)
+{
+    MEASURE measure;
+    for (size_t i_size = 0; i_size < COUNT_SIZES; ++i_size)
+    {
+        const size_t count = COUNTS[i_size];
+        const size_t repeat = rounds(count);
+        const NT_STRING **keys = makeKeys(count, 12);
+
+        NT_TABLE table;
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            ntInitTable(&table);
+            for (size_t i = 0; i < count; ++i)
+                sink += ntTableSet(&table, keys[i], (void *)keys[i]);
+            if (r + 1 < repeat)
+                ntDeinitTable(&table);
+        }
+        end(&measure, "ntTableSet", count, count * repeat);
+
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                void *value = NULL;
+                sink += ntTableGet(&table, keys[i], &value);
+            }
+        }
+        end(&measure, "ntTableGet", count, count * repeat);
+
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+                sink += (uintptr_t)ntTableFindString(&table, keys[i]->chars, keys[i]->length,
+                                                     keys[i]->hash);
+        }
+        end(&measure, "ntTableFindString", count, count * repeat);
+
+        ntDeinitTable(&table);
+        freeKeys(keys, count);
+    }
+}
+
+static void benchCopyString(void)
+{
+    MEASURE measure;
+    for (size_t i_size = 0; i_size < LENGTH_SIZES; ++i_size)
+    {
+        const size_t length = LENGTHS[i_size];
+        const size_t count = 1024;
+        const size_t repeat = rounds(count * length / 8);
+        const NT_STRING **keys = makeKeys(count, length);
+
+        // the contents are interned already, so every copy is a lookup
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const NT_STRING *copy = ntCopyString(keys[i]->chars, length);
+                sink += (uintptr_t)copy;
+                ntFreeObject((NT_OBJECT *)copy);
+            }
+        }
+        end(&measure, "ntCopyString(interned)", length, count * repeat);
+
+        // a string nothing else holds is interned, then released
+        char_t *chars = (char_t *)ntMalloc(sizeof(char_t) * length);
+        for (size_t i = 0; i < length; ++i)
+            chars[i] = U'n';
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                chars[0] = U'0' + (char_t)(i % 64);
+                const NT_STRING *copy = ntCopyString(chars, length);
+                sink += (uintptr_t)copy;
+                ntFreeObject((NT_OBJECT *)copy);
+            }
+        }
+        end(&measure, "ntCopyString(new)", length, count * repeat);
+
+        ntFree(chars);
+        freeKeys(keys, count);
+    }
+}
+
+static void benchVarint(void)
+{
+    // values taking 1, 2, 3 and 5 bytes, the bytecode holds no wider ones
+    static const uint64_t VALUES[] = {100, 10000, 1000000, UINT32_MAX};
+    MEASURE measure;
+    uint8_t buffer[16 * 1024];
+    for (size_t i_value = 0; i_value < sizeof(VALUES) / sizeof(VALUES[0]); ++i_value)
+    {
+        const uint64_t value = VALUES[i_value];
+        const size_t encoded = ntEncodeVarint(buffer, sizeof(buffer), value);
+        const size_t count = sizeof(buffer) / encoded;
+        const size_t repeat = rounds(count);
+
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i < count; ++i)
+                offset += ntEncodeVarint(buffer + offset, sizeof(buffer) - offset, value - (i & 1));
+            sink += offset;
+        }
+        end(&measure, "ntEncodeVarint", encoded, count * repeat);
+
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint64_t decoded;
+                offset += ntDecodeVarint(buffer + offset, sizeof(buffer) - offset, &decoded);
+                sink += decoded;
+            }
+        }
+        end(&measure, "ntDecodeVarint", encoded, count * repeat);
+    }
+}
+
+static void benchArray(void)
+{
+    MEASURE measure;
+    for (size_t i_size = 0; i_size < COUNT_SIZES; ++i_size)
+    {
+        const size_t count = COUNTS[i_size];
+        const size_t repeat = rounds(count);
+
+        NT_ARRAY array;
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            ntInitArray(&array);
+            for (uint32_t i = 0; i < count; ++i)
+                sink += ntArrayAdd(&array, &i, sizeof(i));
+            if (r + 1 < repeat)
+                ntDeinitArray(&array);
+        }
+        end(&measure, "ntArrayAdd", count, count * repeat);
+
+        // a scan over the whole array each time, for the last element
+        const uint32_t last = (uint32_t)count - 1;
+        const size_t finds = rounds(count) / 4 + 16;
+        begin(&measure);
+        for (size_t r = 0; r < finds; ++r)
+        {
+            size_t offset = 0;
+            sink += ntArrayFind(&array, &last, sizeof(last), &offset) + offset;
+        }
+        end(&measure, "ntArrayFind", count, finds);
+
+        ntDeinitArray(&array);
+    }
+}
+
+static void benchConcat(void)
+{
+    MEASURE measure;
+    for (size_t i_size = 0; i_size < LENGTH_SIZES; ++i_size)
+    {
+        const size_t length = LENGTHS[i_size];
+        const size_t count = 64;
+        const size_t repeat = rounds(count * length / 8);
+        const NT_STRING **left = makeKeys(count, length);
+        const NT_STRING **right = makeKeys(1, length);
+
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const NT_STRING *result = ntConcat((NT_OBJECT *)left[i], (NT_OBJECT *)right[0]);
+                sink += result->length;
+                ntFreeObject((NT_OBJECT *)result);
+            }
+        }
+        end(&measure, "ntConcat", length, count * repeat);
+
+        freeKeys(left, count);
+        freeKeys(right, 1);
+    }
+}
+
+static void benchConvert(void)
+{
+    MEASURE measure;
+    for (size_t i_size = 0; i_size < LENGTH_SIZES; ++i_size)
+    {
+        const size_t length = LENGTHS[i_size];
+        const size_t repeat = rounds(length / 8);
+
+        // two bytes in UTF-8 every fourth character
+        char_t *wide = (char_t *)ntMalloc(sizeof(char_t) * length);
+        for (size_t i = 0; i < length; ++i)
+            wide[i] = i % 4 == 3 ? U'\u00e7' : U'a' + i % 26;
+
+        char *narrow = NULL;
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            ntFree(narrow);
+            narrow = ntToCharFixed(wide, length);
+            sink += (uint8_t)narrow[0];
+        }
+        end(&measure, "ntToCharFixed", length, repeat);
+
+        const size_t bytes = strlen(narrow);
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            char_t *converted = ntToCharTFixed(narrow, bytes);
+            sink += converted[0];
+            ntFree(converted);
+        }
+        end(&measure, "ntToCharTFixed", length, repeat);
+
+        ntFree(narrow);
+        ntFree(wide);
+    }
+}
+
+static void benchStack(void)
+{
+    static const size_t SIZES[] = {sizeof(uint32_t), sizeof(uint64_t), 4 * sizeof(uint64_t)};
+    MEASURE measure;
+    NT_VM *vm = ntCreateVM(NULL);
+    uint64_t data[4] = {1, 2, 3, 4};
+    for (size_t i_size = 0; i_size < sizeof(SIZES) / sizeof(SIZES[0]); ++i_size)
+    {
+        const size_t size = SIZES[i_size];
+        const size_t depth = 64;
+        const size_t repeat = rounds(depth);
+
+        // a push and a pop each
+        begin(&measure);
+        for (size_t r = 0; r < repeat; ++r)
+        {
+            for (size_t i = 0; i < depth; ++i)
+                sink += ntPush(vm, data, size);
+            for (size_t i = 0; i < depth; ++i)
+                sink += ntPop(vm, data, size);
+        }
+        end(&measure, "ntPush/ntPop", size, depth * repeat);
+    }
+    ntFreeVM(vm);
+}
+
+// a reference taken and dropped again, on an object of one thread and on an interned string
+static void benchRefCount(void)
+{
+    MEASURE measure;
+    NT_OBJECT *object = (NT_OBJECT *)ntCreateAssembly();
+    begin(&measure);
+    for (size_t i = 0; i < OPS; ++i)
+    {
+        ntRefObject(object);
+        ntFreeObject(object);
+    }
+    end(&measure, "ntRefObject/ntFreeObject", 0, OPS);
+    ntFreeObject(object);
+
+    const NT_STRING **keys = makeKeys(1, 8);
+    begin(&measure);
+    for (size_t i = 0; i < OPS; ++i)
+    {
+        ntRefObject((NT_OBJECT *)keys[0]);
+        ntFreeObject((NT_OBJECT *)keys[0]);
+    }
+    end(&measure, "ntRefObject/ntFreeObject string", 8, OPS);
+    freeKeys(keys, 1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *only = argc > 1 ? argv[1] : NULL;
+    printf("primitive,size,ops,ns_per_op,allocations_per_op\n");
+
+    static const struct
+    {
+        const char *name;
+        void (*run)(void);
+    } BENCHES[] = {
+        {"table", benchTable},   {"string", benchCopyString}, {"varint", benchVarint},
+        {"array", benchArray},   {"concat", benchConcat},     {"convert", benchConvert},
+        {"stack", benchStack},   {"refcount", benchRefCount},
+    };
+    for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); ++i)
+    {
+        if (!only || strcmp(only, BENCHES[i].name) == 0)
+            BENCHES[i].run();
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+import argparse, glob, json, os, statistics, subprocess, sys, time
+
+# Runs the bench/*.nt workloads and prints one JSON document with the median wall time of each
+# and the instructions it executed per second, a table goes to stderr.
+
+benchdir = os.path.dirname(os.path.abspath(__file__))
+rootdir = os.path.dirname(benchdir)
+
+
+def build():
+    builddir = os.path.join(rootdir, "build-bench")
+    subprocess.run(["cmake", "-S", rootdir, "-B", builddir, "-DCMAKE_BUILD_TYPE=Release"],
+                   check=True, stdout=subprocess.DEVNULL)
+    subprocess.run(["cmake", "--build", builddir, "--target", "ntc-bin", "-j", str(os.cpu_count())],
+                   check=True, stdout=subprocess.DEVNULL)
+
+
+def commit():
+    try:
+        proc = subprocess.run(["git", "-C", rootdir, "rev-parse", "HEAD"], capture_output=True,
+                              text=True)
+        return proc.stdout.strip() if proc.returncode == 0 else None
+    except OSError:
+        return None
+
+
+# the count comes from an interpreted run with --count, the same for every run of a workload
+def count(ntc, file):
+    proc = subprocess.run([ntc, "--count", file], capture_output=True, text=True)
+    if proc.returncode != 0:
+        raise RuntimeError(f"{file} failed with {proc.returncode}")
+    for line in proc.stderr.splitlines():
+        if line.startswith("instructions: "):
+            return int(line[len("instructions: "):])
+    raise RuntimeError(f"{file} printed no instruction count")
+
+
+def measure(ntc, file, runs):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        proc = subprocess.run([ntc, file], stdout=subprocess.DEVNULL)
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            raise RuntimeError(f"{file} failed with {proc.returncode}")
+        times.append(elapsed)
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--ntc", default=os.path.join(rootdir, "bin", "ntc"))
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--build", action="store_true", help="build ntc in Release first")
+    parser.add_argument("--output", help="write the JSON here instead of stdout")
+    parser.add_argument("workloads", nargs="*", help="names to run, all by default")
+    args = parser.parse_args()
+
+    if args.build:
+        build()
+
+    files = sorted(glob.glob(os.path.join(benchdir, "*.nt")))
+    if args.workloads:
+        files = [f for f in files if os.path.splitext(os.path.basename(f))[0] in args.workloads]
+
+    results = []
+    for file in files:
+        name = os.path.splitext(os.path.basename(file))[0]
+        instructions = count(args.ntc, file)
+        times = measure(args.ntc, file, args.runs)
+        median = statistics.median(times)
+        results.append({
+            "name": name,
+            "median_s": median,
+            "min_s": min(times),
+            "max_s": max(times),
+            "instructions": instructions,
+            "instructions_per_s": instructions / median,
+        })
+        print(f"{name:<12}{median * 1000:>10.1f} ms{instructions / median / 1e6:>12.1f} Minstr/s",
+              file=sys.stderr)
+
+    report = {"commit": commit(), "runs": args.runs, "results": results}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(report, f, indent=2)
+            f.write("\n")
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == "__main__":
+    main()
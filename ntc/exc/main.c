@@ -29,10 +29,15 @@ SOFTWARE.
 #include <netuno/memory.h>
 #include <netuno/ntc.h>
 #include <netuno/path.h>
+#include <netuno/profile.h>
 #include <netuno/str.h>
+#include <netuno/task.h>
+#include <netuno/tracelog.h>
 #include <netuno/vm.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static char *readFile(const char *filepath, size_t *length)
@@ -111,24 +116,61 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    const size_t count = argc - 1;
+    // --profile[=file] samples the run and writes its collapsed stacks, to ntc.folded by default
+    // --trace[=file] logs the last executed instructions, to ntc.trace by default
+    // --count prints how many instructions the run executed to stderr
+    // --guard-pages maps the stacks below guard pages, which catch overflows instead of checks
+    // --fuel=n runs the program in slices of n backward branches and calls, and prints to stderr
+    // how many times it yielded
+    const char *profilePath = NULL;
+    const char *tracePath = NULL;
+    bool countInstructions = false;
+    bool guardPages = false;
+    uint64_t fuel = NT_FUEL_UNLIMITED;
+    int first = 1;
+    for (; first < argc - 1; ++first)
+    {
+        const char *arg = argv[first];
+        if (strncmp(arg, "--profile", 9) == 0 && (arg[9] == '\0' || arg[9] == '='))
+            profilePath = arg[9] == '=' ? arg + 10 : "ntc.folded";
+        else if (strncmp(arg, "--trace", 7) == 0 && (arg[7] == '\0' || arg[7] == '='))
+            tracePath = arg[7] == '=' ? arg + 8 : "ntc.trace";
+        else if (strcmp(arg, "--count") == 0)
+            countInstructions = true;
+        else if (strcmp(arg, "--guard-pages") == 0)
+            guardPages = true;
+        else if (strncmp(arg, "--fuel=", 7) == 0)
+        {
+            char *end;
+            fuel = strtoull(arg + 7, &end, 10);
+            if (end == arg + 7 || *end != '\0' || fuel == 0 || fuel == NT_FUEL_UNLIMITED)
+            {
+                printf("Error: invalid fuel %s\n", arg + 7);
+                return 2;
+            }
+        }
+        else
+            break;
+    }
+
+    const size_t count = argc - first;
     NT_FILE *files = (NT_FILE *)ntMalloc(sizeof(NT_FILE) * count);
 
     for (size_t i = 0; i < count; ++i)
     {
-        char_t *filepath = ntToCharT(argv[i + 1]);
+        char_t *filepath = ntToCharT(argv[i + first]);
         size_t length;
-        char *code = readFile(argv[i + 1], &length);
+        char *code = readFile(argv[i + first], &length);
         if (code == NULL)
         {
-            printf("Error: could not open file %s\n", argv[i + 1]);
+            printf("Error: could not open file %s\n", argv[i + first]);
             return 1;
         }
 
         char_t *codet = ntToCharTFixed(code, length);
         if (!codet)
         {
-            printf("Fail to covert file %s to UTF-32.\n", argv[i + 1]);
+            printf("Fail to covert file %s to UTF-32.\n", argv[i + first]);
             return 2;
         }
         ntFree(code);
@@ -147,7 +189,23 @@ int main(int argc, char **argv)
         return -4321;
     }
 
-    NT_VM *vm = ntCreateVM();
+    // tasks run the assembly on other threads, so it settles before anything runs it
+    if (ntAssemblySpawns(assembly) && !ntFreezeAssembly(assembly))
+    {
+        printf("Error: could not freeze the assembly for tasks\n");
+        ntFreeObject((NT_OBJECT *)assembly);
+        return -4321;
+    }
+
+    const NT_VM_CONFIG config = {
+        .stackSize = NT_STACK_SIZE,
+        .stackLimit = NT_STACK_LIMIT,
+        .callStackSize = NT_CALL_STACK_SIZE,
+        .callStackLimit = NT_CALL_STACK_LIMIT,
+        .invokeLimit = NT_INVOKE_LIMIT,
+        .flags = guardPages ? NT_VM_GUARD_PAGES : 0,
+    };
+    NT_VM *vm = ntCreateVM(&config);
 
     const NT_DELEGATE *entryPoint = findEntryPoint(assembly, U"main");
     if (entryPoint == NULL)
@@ -155,7 +213,55 @@ int main(int argc, char **argv)
         printf("undefined reference to \"main\"\n");
         return -1234;
     }
+
+    NT_PROFILE *profile = NULL;
+    if (profilePath && (profile = ntStartProfile(vm, 1000)) == NULL)
+        printf("Warning: could not start the profiler\n");
+    // counting needs no entries but the latest, the head of the log counts them all
+    NT_TRACE_LOG *traceLog = NULL;
+    if ((tracePath || countInstructions) &&
+        (traceLog = ntCreateTraceLog(tracePath ? NT_TRACE_LOG_SIZE : 1)) != NULL)
+        ntSetTraceLog(vm, traceLog);
+    ntSetFuel(vm, fuel);
     NT_RESULT vmResult = ntRun(vm, assembly, entryPoint);
+    // every time the tank runs dry the host has control again, and fills it up for another slice
+    uint64_t yields = 0;
+    while (vmResult == NT_YIELD)
+    {
+        ++yields;
+        ntSetFuel(vm, fuel);
+        vmResult = ntContinue(vm);
+    }
+    if (fuel != NT_FUEL_UNLIMITED)
+        fprintf(stderr, "yields: %" PRIu64 "\n", yields);
+    // tasks nobody joined finish before their assembly goes away
+    ntStopTasks();
+    if (traceLog && countInstructions)
+        fprintf(stderr, "instructions: %" PRIu64 "\n", (uint64_t)atomic_load(&traceLog->head));
+    if (traceLog && tracePath)
+    {
+        FILE *file = fopen(tracePath, "wb");
+        if (file == NULL || !ntWriteTraceLog(traceLog, file))
+            printf("Error: could not write the trace to %s\n", tracePath);
+        if (file)
+            fclose(file);
+    }
+    if (traceLog)
+    {
+        ntSetTraceLog(vm, NULL);
+        ntFreeTraceLog(traceLog);
+    }
+    if (profile)
+    {
+        ntStopProfile(profile);
+        FILE *file = fopen(profilePath, "w");
+        if (file == NULL || !ntWriteProfile(profile, file))
+            printf("Error: could not write the profile to %s\n", profilePath);
+        if (file)
+            fclose(file);
+        ntFreeProfile(profile);
+    }
+
     if (vmResult != NT_OK)
     {
         switch (vmResult)
@@ -12,5 +12,19 @@ typedef struct _NT_FILE
     const char_t *filename;
 } NT_FILE;
 
+// the scanner runs within the parse, on demand
+typedef enum
+{
+    NT_PHASE_PARSE,
+    NT_PHASE_RESOLVE,
+    NT_PHASE_GEN,
+} NT_PHASE;
+
+// called as each phase starts and once it is done, even when it failed
+typedef void (*NT_PHASE_HOOK)(NT_PHASE phase, bool done, void *userdata);
+
 NT_ASSEMBLY *ntCompile(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *files);
+// ntCompile, reporting its phases to hook
+NT_ASSEMBLY *ntCompileObserved(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *files,
+                               NT_PHASE_HOOK hook, void *userdata);
 #endif
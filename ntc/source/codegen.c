@@ -234,6 +234,9 @@ static size_t emitPop(NT_MODGEN *modgen, const NT_NODE *node, const NT_TYPE *typ
     {
     case NT_OBJECT_STRING:
     case NT_OBJECT_CUSTOM:
+        // references are as wide as a pointer
+        emit(modgen, node, sizeof(NT_REF) == sizeof(uint64_t) ? BC_POP_64 : BC_POP_32);
+        break;
     case NT_OBJECT_I32:
     case NT_OBJECT_U32:
     case NT_OBJECT_F32:
@@ -290,6 +293,19 @@ static void emitPartialFixedPop(NT_MODGEN *modgen, const NT_NODE *node, const si
     ntWriteModuleVarint(modgen->module, popSize / sizeof(uint32_t), node->token.line);
 }
 
+// Pops bytes of the frame that need not end at a value, like the ones above @return, which
+// starts at the first parameter whatever the widths of the parameters are.
+static void emitRawPop(NT_MODGEN *modgen, const NT_NODE *node, const size_t popSize)
+{
+    if (popSize == 0)
+        return;
+
+    assert(popSize % sizeof(uint32_t) == 0);
+
+    emit(modgen, node, BC_POP);
+    ntWriteModuleVarint(modgen->module, popSize / sizeof(uint32_t), node->token.line);
+}
+
 static size_t emitFixedPop(NT_MODGEN *modgen, const NT_NODE *node, const size_t popSize)
 {
     if (popSize == 0)
@@ -2025,52 +2041,69 @@ static void logical(NT_MODGEN *modgen, const NT_NODE *node)
     }
 }
 
-static void get(NT_MODGEN *modgen, const NT_NODE *node)
+// Walks the left side of a get through the modules and functions in scope. Returns the last
+// one found, entry receives the symbol where the walk stopped.
+static NT_OBJECT *getOwner(NT_MODGEN *modgen, const NT_NODE *node, NT_SYMBOL_ENTRY *entry)
 {
-    assert(modgen);
-    assert(node);
-    assert(node->type.class == NC_EXPR);
-    assert(node->type.kind == NK_GET);
-
     NT_NODE *current = node->left;
     NT_OBJECT *constantObject = NULL;
 
-    NT_SYMBOL_ENTRY entry;
-    entry.type = SYMBOL_TYPE_NONE;
+    entry->type = SYMBOL_TYPE_NONE;
     do
     {
         const bool result = ntLookupSymbol(modgen->scope, current->token.lexeme,
-                                           current->token.lexemeLength, NULL, &entry);
+                                           current->token.lexemeLength, NULL, entry);
 
-        if (result && (entry.type &
+        if (result && (entry->type &
                        (SYMBOL_TYPE_MODULE | SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) != 0)
         {
-            constantObject = (NT_OBJECT *)entry.data;
+            constantObject = (NT_OBJECT *)entry->data;
             current = current->left;
         }
         else
             break;
     } while (current);
 
+    return constantObject;
+}
+
+// the function a get names inside a module or type, NULL when it names something else
+static NT_OBJECT *getMember(const NT_NODE *node, NT_OBJECT *owner)
+{
+    if (!owner || owner->type->objectType != NT_OBJECT_TYPE_TYPE)
+        return NULL;
+
+    NT_SYMBOL_ENTRY entry;
+    NT_TYPE *type = (NT_TYPE *)owner;
+    const bool result =
+        ntLookupSymbol(&type->fields, node->token.lexeme, node->token.lexemeLength, NULL, &entry);
+    if (result &&
+        (entry.type & (SYMBOL_TYPE_MODULE | SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) != 0)
+        return (NT_OBJECT *)entry.data;
+    return NULL;
+}
+
+static void get(NT_MODGEN *modgen, const NT_NODE *node)
+{
+    assert(modgen);
+    assert(node);
+    assert(node->type.class == NC_EXPR);
+    assert(node->type.kind == NK_GET);
+
+    NT_SYMBOL_ENTRY entry;
+    NT_OBJECT *constantObject = getOwner(modgen, node, &entry);
+
     if (entry.type == SYMBOL_TYPE_NONE)
     {
         ntErrorAtNode(&modgen->report, node->left, "Undeclared symbol");
         return;
     }
 
-    if (constantObject->type->objectType == NT_OBJECT_TYPE_TYPE)
+    NT_OBJECT *member = getMember(node, constantObject);
+    if (member)
     {
-        NT_TYPE *type = (NT_TYPE *)constantObject;
-        const bool result = ntLookupSymbol(&type->fields, node->token.lexeme,
-                                           node->token.lexemeLength, NULL, &entry);
-
-        if (result && (entry.type &
-                       (SYMBOL_TYPE_MODULE | SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) != 0)
-        {
-            constantObject = (NT_OBJECT *)entry.data;
-            emitConstantObject(modgen, node, constantObject);
-            return;
-        }
+        emitConstantObject(modgen, node, member);
+        return;
     }
 
     if (constantObject)
@@ -2083,6 +2116,77 @@ static void get(NT_MODGEN *modgen, const NT_NODE *node)
     assert(0);
 }
 
+// The delegate a call reaches whatever happens at run time: a function named directly or
+// through its module. NULL for calls through delegate values.
+static NT_OBJECT *directCallee(NT_MODGEN *modgen, const NT_NODE *node)
+{
+    NT_SYMBOL_ENTRY entry;
+    switch (node->type.kind)
+    {
+    case NK_VARIABLE:
+        if (!findSymbol(modgen, node->token.lexeme, node->token.lexemeLength, &entry) ||
+            (entry.type & (SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) == 0)
+            return NULL;
+        return (NT_OBJECT *)entry.data;
+    case NK_GET: {
+        NT_OBJECT *member = getMember(node, getOwner(modgen, node, &entry));
+        if (!member || member->type->objectType != NT_OBJECT_DELEGATE)
+            return NULL;
+        return member;
+    }
+    default:
+        return NULL;
+    }
+}
+
+// Emits the arguments of a call, false when they don't match the parameters of the delegate.
+static bool arguments(NT_MODGEN *modgen, const NT_NODE *node,
+                      const NT_DELEGATE_TYPE *delegateType)
+{
+    const size_t callArgsCount = ntListLen(node->data);
+    if (callArgsCount != delegateType->paramCount)
+    {
+        char *name = ntToCharFixed(node->token.lexeme, node->token.lexemeLength);
+        ntErrorAtNode(&modgen->report, node,
+                      "The '%s' call has wrong number of parameters, expect number is "
+                      "%d, not %d.",
+                      name, delegateType->paramCount, callArgsCount);
+        ntFree(name);
+        return false;
+    }
+
+    bool paramError = false;
+    for (size_t i = 0; i < callArgsCount; ++i)
+    {
+        const NT_NODE *arg = (const NT_NODE *)ntListGet(node->data, i);
+        const NT_TYPE *paramType = ntEvalExprType(&modgen->report, modgen->scope, (NT_NODE *)arg);
+        const NT_TYPE *expectType = delegateType->params[i].type;
+
+        expression(modgen, arg, true);
+
+        if (!ntTypeIsAssignableFrom(expectType, paramType))
+        {
+            char *expectTypeName =
+                ntToCharFixed(expectType->typeName->chars, expectType->typeName->length);
+            char *paramTypeName =
+                ntToCharFixed(paramType->typeName->chars, paramType->typeName->length);
+            char *paramName = ntToCharFixed(delegateType->params[i].name->chars,
+                                            delegateType->params[i].name->length);
+
+            ntErrorAtNode(&modgen->report, arg,
+                          "The argument('%s', %d) expect a value of type '%s', not '%s'.",
+                          paramName, i, expectTypeName, paramTypeName);
+
+            ntFree(expectTypeName);
+            ntFree(paramTypeName);
+            ntFree(paramName);
+            paramError = true;
+        }
+    }
+
+    return !paramError;
+}
+
 static void call(NT_MODGEN *modgen, const NT_NODE *node, const bool needValue)
 {
     assert(modgen);
@@ -2141,65 +2245,27 @@ static void call(NT_MODGEN *modgen, const NT_NODE *node, const bool needValue)
 
     const uint32_t sp = modgen->stack->sp;
 
-    const size_t callArgsCount = ntListLen(node->data);
-    if (callArgsCount != delegateType->paramCount)
-    {
-        char *name = ntToCharFixed(node->token.lexeme, node->token.lexemeLength);
-        ntErrorAtNode(&modgen->report, node,
-                      "The '%s' call has wrong number of parameters, expect number is "
-                      "%d, not %d.",
-                      name, delegateType->paramCount, callArgsCount);
-        ntFree(name);
+    if (!arguments(modgen, node, delegateType))
         return;
-    }
 
-    bool paramError = false;
-    for (size_t i = 0; i < callArgsCount; ++i)
+    NT_OBJECT *callee = directCallee(modgen, node->left);
+    if (callee)
     {
-        const NT_NODE *arg = (const NT_NODE *)ntListGet(node->data, i);
-        const NT_TYPE *paramType = ntEvalExprType(&modgen->report, modgen->scope, (NT_NODE *)arg);
-        const NT_TYPE *expectType = delegateType->params[i].type;
-
-        expression(modgen, arg, true);
-
-        if (!ntTypeIsAssignableFrom(expectType, paramType))
-        {
-            char *expectTypeName =
-                ntToCharFixed(expectType->typeName->chars, expectType->typeName->length);
-            char *paramTypeName =
-                ntToCharFixed(paramType->typeName->chars, paramType->typeName->length);
-            char *paramName = ntToCharFixed(delegateType->params[i].name->chars,
-                                            delegateType->params[i].name->length);
-
-            ntErrorAtNode(&modgen->report, arg,
-                          "The argument('%s', %d) expect a value of type '%s', not '%s'.",
-                          paramName, i, expectTypeName, paramTypeName);
-
-            ntFree(expectTypeName);
-            ntFree(paramTypeName);
-            ntFree(paramName);
-            paramError = true;
-        }
+        emit(modgen, node, BC_CALL_DIRECT);
+        const uint64_t index = ntAddConstantObject(modgen->codegen->assembly, callee);
+        ntWriteModuleVarint(modgen->module, index, node->token.line);
     }
-
-    if (paramError)
-        return;
-
-    // emit function name
-    expression(modgen, node->left, needValue);
-    emit(modgen, node, BC_CALL);
-    pop(modgen, node, (const NT_TYPE *)delegateType);
-    if (delegateType->returnType)
-        push(modgen, node, delegateType->returnType);
-
-    size_t delta = modgen->stack->sp - sp;
-
-    if (delta > 0 && delegateType->returnType != NULL)
+    else
     {
-        // ensure that dont virtual pops the arg0, because is the return value.
-        delta -= delegateType->returnType->stackSize;
+        // emit function name
+        expression(modgen, node->left, needValue);
+        emit(modgen, node, BC_CALL);
+        pop(modgen, node, (const NT_TYPE *)delegateType);
     }
-    vFixedPop(modgen, delta);
+    // the arguments are consumed by the call, popped before the return value takes their place
+    vFixedPop(modgen, modgen->stack->sp - sp);
+    if (delegateType->returnType)
+        push(modgen, node, delegateType->returnType);
 }
 
 static void expression(NT_MODGEN *modgen, const NT_NODE *node, const bool needValue)
@@ -2544,7 +2610,7 @@ static void endFunctionScope(NT_MODGEN *modgen, const NT_NODE *node, const NT_TY
         assert(scopeSize >= type->stackSize);
 
         const size_t delta = scopeSize - type->stackSize;
-        emitPartialFixedPop(modgen, node, delta);
+        emitRawPop(modgen, node, delta);
 
         if (returnType && *returnType == NULL)
             *returnType = type;
@@ -2712,9 +2778,57 @@ static void declaration(NT_MODGEN *modgen, const NT_NODE *node)
     }
 }
 
+// Emits `return f(...)` as a TAIL_CALL when f is a Netuno function known at compile time. Its
+// arguments take the place of the whole frame, so f returns straight to our caller and
+// recursion in tail position runs in constant stack.
+static bool tailCall(NT_MODGEN *modgen, const NT_NODE *node, const NT_TYPE **returnType)
+{
+    const NT_NODE *callNode = node->left;
+    if (!callNode || callNode->type.kind != NK_CALL)
+        return false;
+
+    const NT_SYMBOL_TABLE *functionScope = modgen->scope;
+    while (!(functionScope->type & (STT_FUNCTION | STT_METHOD)))
+    {
+        functionScope = functionScope->parent;
+    }
+    if (!(functionScope->type & STT_FUNCTION))
+        return false;
+
+    const NT_DELEGATE *callee = (const NT_DELEGATE *)directCallee(modgen, callNode->left);
+    if (!callee || callee->native)
+        return false;
+
+    const NT_TYPE *type = ntEvalExprType(&modgen->report, modgen->scope, (NT_NODE *)callNode);
+    if (modgen->scope->scopeReturnType == NULL ||
+        modgen->scope->scopeReturnType == ntUndefinedType())
+        modgen->scope->scopeReturnType = type;
+    if (modgen->scope->scopeReturnType != type)
+        return false;
+
+    const size_t frameSize = modgen->stack->sp - (size_t)functionScope->data;
+    if (!arguments(modgen, callNode, (const NT_DELEGATE_TYPE *)callee->object.type))
+        return true;
+
+    emit(modgen, node, BC_TAIL_CALL);
+    const uint64_t index = ntAddConstantObject(modgen->codegen->assembly, (NT_OBJECT *)callee);
+    ntWriteModuleVarint(modgen->module, index, node->token.line);
+    ntWriteModuleVarint(modgen->module, frameSize / sizeof(uint32_t), node->token.line);
+
+    // leave the virtual stack as a plain return would
+    vFixedPop(modgen, callee->paramsSize);
+    push(modgen, node, type);
+
+    if (returnType && *returnType == NULL)
+        *returnType = type;
+    return true;
+}
+
 static void returnStatement(NT_MODGEN *modgen, const NT_NODE *node, const NT_TYPE **returnType)
 {
     ensureStmt(node, NK_RETURN);
+    if (tailCall(modgen, node, returnType))
+        return;
     endFunctionScope(modgen, node, returnType, false);
     emit(modgen, node, BC_RETURN);
 }
@@ -29,9 +29,12 @@ SOFTWARE.
 #include <assert.h>
 #include <ctype.h>
 #include <netuno/console.h>
+#include <netuno/fiber.h>
+#include <netuno/io.h>
 #include <netuno/memory.h>
 #include <netuno/ntc.h>
 #include <netuno/str.h>
+#include <netuno/task.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -54,7 +57,19 @@ static bool insertModuleSymbol(NT_SYMBOL_TABLE *table, const NT_MODULE *module)
     return ntInsertSymbol(table, &entry);
 }
 
+static void notify(NT_PHASE_HOOK hook, void *userdata, NT_PHASE phase, bool done)
+{
+    if (hook)
+        hook(phase, done, userdata);
+}
+
 NT_ASSEMBLY *ntCompile(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *files)
+{
+    return ntCompileObserved(assembly, fileCount, files, NULL, NULL);
+}
+
+NT_ASSEMBLY *ntCompileObserved(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *files,
+                               NT_PHASE_HOOK hook, void *userdata)
 {
     assert(assembly != NULL);
     assert(files != NULL);
@@ -64,7 +79,11 @@ NT_ASSEMBLY *ntCompile(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *f
     NT_SYMBOL_TABLE *globalTable = ntCreateSymbolTable(NULL, STT_NONE, NULL);
 
     insertModuleSymbol(globalTable, ntConsoleModule());
+    insertModuleSymbol(globalTable, ntTaskModule());
+    insertModuleSymbol(globalTable, ntFiberModule());
+    insertModuleSymbol(globalTable, ntIoModule());
 
+    notify(hook, userdata, NT_PHASE_PARSE, false);
     for (size_t i = 0; i < fileCount; ++i)
     {
         const NT_FILE *const current = &files[i];
@@ -83,8 +102,11 @@ NT_ASSEMBLY *ntCompile(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *f
 
         insertModuleSymbol(globalTable, module);
     }
+    notify(hook, userdata, NT_PHASE_PARSE, true);
 
+    notify(hook, userdata, NT_PHASE_RESOLVE, false);
     const bool resolveResult = ntResolve(assembly, globalTable, fileCount, nodes);
+    notify(hook, userdata, NT_PHASE_RESOLVE, true);
     assert(resolveResult);
     if (!resolveResult)
     {
@@ -92,8 +114,10 @@ NT_ASSEMBLY *ntCompile(NT_ASSEMBLY *assembly, size_t fileCount, const NT_FILE *f
         goto error;
     }
 
+    notify(hook, userdata, NT_PHASE_GEN, false);
     NT_CODEGEN *codegen = ntCreateCodegen(assembly);
     const bool genResult = ntGen(codegen, fileCount, (const NT_NODE **)nodes);
+    notify(hook, userdata, NT_PHASE_GEN, true);
     assert(genResult);
     if (!genResult)
     {
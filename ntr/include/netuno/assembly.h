@@ -35,6 +35,8 @@ typedef struct _NT_ASSEMBLY
 {
     NT_OBJECT object;
     NT_ARRAY *objects;
+    // set by ntFreezeAssembly, nothing the assembly reaches changes afterwards
+    bool frozen;
 } NT_ASSEMBLY;
 
 const NT_TYPE *ntAssemblyType(void);
@@ -43,5 +45,9 @@ const NT_DELEGATE_TYPE *ntTakeDelegateType(NT_ASSEMBLY *assembly, const NT_TYPE
                                            size_t count, const NT_PARAM *params);
 uint64_t ntAddConstantObject(NT_ASSEMBLY *assembly, NT_OBJECT *object);
 NT_OBJECT *ntGetConstantObject(const NT_ASSEMBLY *assembly, uint64_t constant);
+// Translates the assembly and settles all state the runtime would otherwise set up lazily:
+// builtin types, native modules and compiled code. Once frozen, VMs on any number of threads
+// may run the assembly at the same time. Returns false if it does not translate.
+bool ntFreezeAssembly(NT_ASSEMBLY *assembly);
 
 #endif
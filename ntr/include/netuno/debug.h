@@ -27,9 +27,75 @@ SOFTWARE.
 
 #include <netuno/assembly.h>
 #include <netuno/module.h>
+#include <netuno/opcode.h>
+#include <stdio.h>
 
 void ntDisassembleModule(const NT_ASSEMBLY *assembly, const NT_MODULE *module, const char *name);
 size_t ntDisassembleInstruction(const NT_ASSEMBLY *assembly, const NT_MODULE *module,
                                 const size_t offset);
+void ntDisassembleTranslated(const NT_MODULE *module, const NT_INSTRUCTION *instruction);
+
+#ifdef NT_OPCODE_COUNTS
+// slots for the opcode triples, few of the possible ones ever run
+#define NT_OPCODE_TRIPLES (1 << 16)
+
+typedef struct
+{
+    // the three opcodes plus one, 0 for a free slot
+    uint32_t key;
+    uint64_t count;
+} NT_OPCODE_TRIPLE;
+
+// How often each opcode ran in a VM, and each sequence of two and three of them, to pick fused
+// opcodes and the dispatch order from real workloads.
+typedef struct _NT_OPCODE_PROFILE
+{
+    // the two opcodes that ran last plus one, the latest in the low byte, 0 before any ran
+    uint32_t history;
+    uint64_t opcodes[BC_LAST];
+    uint64_t pairs[BC_LAST][BC_LAST];
+    NT_OPCODE_TRIPLE triples[NT_OPCODE_TRIPLES];
+    // triples that found the table full
+    uint64_t lost;
+} NT_OPCODE_PROFILE;
+
+static inline void ntCountOpcodeTriple(NT_OPCODE_PROFILE *counts, const uint32_t key,
+                                       const uint64_t count)
+{
+    uint32_t slot = key * 2654435761u >> 16;
+    for (size_t probes = 0; probes < NT_OPCODE_TRIPLES; ++probes, ++slot)
+    {
+        NT_OPCODE_TRIPLE *triple = &counts->triples[slot & (NT_OPCODE_TRIPLES - 1)];
+        if (triple->key == key || triple->key == 0)
+        {
+            triple->key = key;
+            triple->count += count;
+            return;
+        }
+    }
+    counts->lost += count;
+}
+
+static inline void ntCountOpcode(NT_OPCODE_PROFILE *counts, const uint8_t opcode)
+{
+    const uint32_t history = counts->history;
+    counts->history = (history << 8 | (opcode + 1u)) & 0xFFFF;
+    counts->opcodes[opcode]++;
+    if ((history & 0xFF) == 0)
+        return;
+    counts->pairs[(history & 0xFF) - 1][opcode]++;
+    if (history <= 0xFF)
+        return;
+    ntCountOpcodeTriple(counts, history << 8 | (opcode + 1u), 1);
+}
+
+NT_OPCODE_PROFILE *ntCreateOpcodeCounts(void);
+// Adds the counts of from to into, for tasks handing theirs to the VM that joins them. Sequences
+// that span both runs are not counted.
+void ntMergeOpcodeCounts(NT_OPCODE_PROFILE *into, const NT_OPCODE_PROFILE *from);
+// Writes the counts as CSV, "kind,first,second,third,count" rows with the opcodes by name, the
+// most frequent first within each kind.
+void ntWriteOpcodeCounts(const NT_OPCODE_PROFILE *counts, FILE *file);
+#endif
 
 #endif
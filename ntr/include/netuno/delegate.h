@@ -25,6 +25,7 @@ SOFTWARE.
 #ifndef NT_DELEGATE_H
 #define NT_DELEGATE_H
 
+#include <netuno/instruction.h>
 #include <netuno/object.h>
 #include <netuno/type.h>
 
@@ -56,9 +57,18 @@ struct _NT_DELEGATE
         {
             size_t addr;
             const NT_MODULE *sourceModule;
+            const NT_INSTRUCTION *entry;
+            // bytes the verified body grows the stack above its arguments
+            size_t maxStack;
+            // calls counted toward NT_JIT_THRESHOLD and the compiled body, if there is one
+            uint32_t calls;
+            void *jit;
         };
         nativeFun func;
     };
+    // bytes of the arguments and of the return value on the stack, fixed by the delegate type
+    size_t paramsSize;
+    size_t returnSize;
     bool native;
 };
 
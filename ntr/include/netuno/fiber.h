@@ -0,0 +1,41 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_FIBER_H
+#define NT_FIBER_H
+
+#include <netuno/module.h>
+
+// Native module over the fibers of the VM, see ntResume and ntYield:
+//
+//     var handle = fiber.create(f)
+//     var value = fiber.resume(handle, arg)  // runs f(arg) until it yields or returns
+//     var next = fiber.yield(value)          // inside f, next is the value of the next resume
+//
+// fiber.done tells whether f returned, and fiber.free releases a fiber that is neither
+// running nor parked on the event loop. Handles are only valid on the thread that created
+// them and until fiber.free; any other handle fails the call with a runtime error.
+const NT_MODULE *ntFiberModule(void);
+
+#endif
@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_HANDLE_H
+#define NT_HANDLE_H
+
+#include "common.h"
+
+// the slot of no handle, firstFree of an empty table
+#define NT_NO_SLOT UINT32_MAX
+
+// Native modules hand handles to scripts instead of pointers. A handle is the generation of its
+// slot in the high 32 bits and the index in the low ones, so a released or forged handle finds
+// nothing. A table is not synchronised, threads sharing one lock around it.
+typedef struct
+{
+    void *data;
+    uint32_t generation;
+    uint32_t nextFree;
+} NT_HANDLE_SLOT;
+
+typedef struct _NT_HANDLES
+{
+    NT_HANDLE_SLOT *slots;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t firstFree;
+} NT_HANDLES;
+
+void ntInitHandles(NT_HANDLES *handles);
+// frees the table, but none of the data its live handles point to
+void ntDeinitHandles(NT_HANDLES *handles);
+uint64_t ntAddHandle(NT_HANDLES *handles, void *data);
+// the data of a live handle, NULL for any other value
+void *ntGetHandle(const NT_HANDLES *handles, uint64_t handle);
+// like ntGetHandle, and the handle is released, so no one gets the data through it again
+void *ntTakeHandle(NT_HANDLES *handles, uint64_t handle);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_INSTRUCTION_H
+#define NT_INSTRUCTION_H
+
+#include <netuno/common.h>
+
+// lower functions to register instructions at load time, build with NT_NO_REGISTER_TIER to keep
+// the plain stack form
+#ifndef NT_NO_REGISTER_TIER
+#define NT_REGISTER_TIER
+#endif
+
+typedef struct _NT_OBJECT NT_OBJECT;
+typedef struct _NT_MODULE NT_MODULE;
+typedef struct _NT_ASSEMBLY NT_ASSEMBLY;
+typedef struct _NT_INSTRUCTION NT_INSTRUCTION;
+
+// Fixed-width form of one bytecode instruction, built from the compact varint stream when a
+// module is loaded. Constants, objects and branch targets are already resolved, so the
+// interpreter never decodes a varint or looks up a constant table.
+struct _NT_INSTRUCTION
+{
+    uint16_t opcode;
+    // stack growth in bytes applied by register instructions
+    int16_t delta;
+    union {
+        // stack offset (LOAD_SP/STORE_SP) or size (POP) in bytes
+        uint32_t operand;
+        // destination slot of register instructions
+        int32_t dst;
+    };
+    union {
+        uint32_t value32;
+        uint64_t value64;
+        NT_OBJECT *object;
+        const NT_INSTRUCTION *target;
+        // source slots of register instructions, right is a constant in the _K forms
+        struct
+        {
+            int32_t left;
+            int32_t right;
+        };
+    };
+};
+
+// Bytes an instruction pops and pushes, false for the ones whose effect depends on an operand,
+// the callee or the caller (POP, CALL, RETURN, ...).
+bool ntStackEffect(uint32_t opcode, size_t *pops, size_t *pushes);
+bool ntTranslateModule(NT_MODULE *module, const NT_ASSEMBLY *assembly);
+bool ntTranslateAssembly(NT_ASSEMBLY *assembly);
+// Compiles every function of a translated module up front and stops the interpreter from
+// profiling it, the profile counters are the only state running code writes.
+void ntFreezeModule(NT_MODULE *module);
+size_t ntInstructionPc(const NT_MODULE *module, const NT_INSTRUCTION *instruction);
+
+#endif
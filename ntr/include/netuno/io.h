@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_IO_H
+#define NT_IO_H
+
+#include <netuno/module.h>
+#include <netuno/vm.h>
+
+// readiness of a descriptor, the values of EPOLLIN and EPOLLOUT
+#define NT_IO_READ 0x001
+#define NT_IO_WRITE 0x004
+
+// computes the result of a wait once the descriptor is ready, data is the one of the wait
+typedef uint32_t (*NT_IO_COMPLETE)(int fd, uint32_t events, uint64_t data);
+
+// For natives returning int. Waits until fd is ready for events and pushes what complete
+// returns, or the ready events when it is NULL. A fiber parks on the event loop of its thread
+// and yields 0 to its resumer, the loop resumes it once fd is ready. Anything that cannot park
+// runs the loop itself meanwhile, so parked fibers keep going.
+bool ntWaitFd(NT_VM *vm, int fd, uint32_t events, NT_IO_COMPLETE complete, uint64_t data);
+// like ntWaitFd for a timer, pushing 0
+bool ntSleep(NT_VM *vm, uint32_t milliseconds);
+// Runs the loop until fd is ready, for natives whose result cannot wait for a resume. Returns
+// right away when nothing is parked, the blocking call that follows waits just as well.
+bool ntAwaitFd(NT_VM *vm, int fd, uint32_t events);
+// runs the loop of the thread until no fiber is parked on it
+bool ntRunLoop(NT_VM *vm);
+
+// Native module over the event loop, where a pipe or socket pair is a long holding the read end
+// in its low 32 bits:
+//
+//     var pair = io.pipe()
+//     io.write(int(pair / 4294967296l), 42)  // parks until the descriptor takes it
+//     var value = io.read(int(pair % 4294967296l))  // -1 at the end of the stream
+//     io.sleep(10)
+//     io.run()  // until every parked fiber finished
+const NT_MODULE *ntIoModule(void);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_JIT_H
+#define NT_JIT_H
+
+#include <netuno/vm.h>
+
+// The baseline JIT emits System V x86-64 code. It stays off while tracing execution or counting
+// opcodes, compiled code neither traces, counts nor keeps the debug stack types.
+#if defined(__x86_64__) && defined(__linux__) && !defined(DEBUG_TRACE_EXECUTION) &&              \
+    !defined(NT_OPCODE_COUNTS) && !defined(NT_NO_JIT)
+#define NT_JIT
+#endif
+
+// calls through ntCall before a delegate is compiled
+#ifndef NT_JIT_THRESHOLD
+#define NT_JIT_THRESHOLD 1000
+#endif
+
+// backward branches taken before the loop they close is traced
+#ifndef NT_TRACE_THRESHOLD
+#define NT_TRACE_THRESHOLD 500
+#endif
+
+// conditional branches a trace can guard
+#define NT_TRACE_BRANCHES 64
+
+#ifdef NT_JIT
+// One iteration of a hot loop, recorded by run() as the directions of the conditional branches
+// it took in the frame of the loop.
+typedef struct
+{
+    // backward BRANCH closing the loop, NULL while nothing is recorded
+    const NT_INSTRUCTION *loop;
+    // bytes on the call stack in the frame of the loop, the stack moves when it grows
+    size_t callDepth;
+    size_t count;
+    bool directions[NT_TRACE_BRANCHES];
+} NT_TRACE_RECORDER;
+
+// Translates the translated body of a verified delegate into machine code, one template per
+// instruction working on the VM stack. Returns false, leaving the delegate interpreted, when
+// the body holds an instruction without a template.
+bool ntJitCompile(NT_DELEGATE *delegate);
+// Runs the compiled body of a delegate whose arguments are on the stack.
+bool ntJitEnter(NT_VM *vm, const NT_DELEGATE *delegate);
+void ntJitFree(NT_DELEGATE *delegate);
+
+// Compiles the recorded path through a loop into native code that guards every branch on its
+// recorded direction, then turns the closing branch into a BC_LOOP_TRACE entering it. Returns
+// false, leaving the loop interpreted, when the path can't be compiled.
+bool ntJitCompileTrace(const NT_MODULE *module, const NT_TRACE_RECORDER *recorder);
+// Runs a trace until a guard fails, returning the instruction where the interpreter resumes or
+// NULL when a call made by the trace failed.
+const NT_INSTRUCTION *ntJitEnterTrace(NT_VM *vm, const NT_INSTRUCTION *instruction);
+// the loop header a BC_LOOP_TRACE branches to when its trace is not entered
+const NT_INSTRUCTION *ntJitTraceHeader(const NT_INSTRUCTION *instruction);
+void ntJitFreeTraces(NT_MODULE *module);
+#endif
+
+#endif
@@ -26,10 +26,13 @@ SOFTWARE.
 #define NT_MEMORY_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 void *ntMalloc(size_t size);
 void ntFree(void *);
 void *ntRealloc(void *old, size_t size);
 void ntMemcpy(void *dst, const void *src, size_t size);
+// calls of ntMalloc and ntRealloc the calling thread made so far
+uint64_t ntAllocations(void);
 
 #endif
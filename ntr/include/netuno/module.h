@@ -27,6 +27,7 @@ SOFTWARE.
 
 #include <netuno/assembly.h>
 #include <netuno/delegate.h>
+#include <netuno/instruction.h>
 #include <netuno/object.h>
 #include <netuno/type.h>
 
@@ -42,6 +43,10 @@ typedef struct _NT_MODULE
     NT_ARRAY code;
     NT_ARRAY lines;
     NT_ARRAY constants;
+    // translated form of code, built by ntTranslateModule before the module first runs
+    NT_INSTRUCTION *instructions;
+    size_t *instructionPcs;
+    size_t instructionCount;
 } NT_MODULE;
 
 const NT_TYPE *ntModuleType(void);
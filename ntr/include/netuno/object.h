@@ -29,6 +29,7 @@ SOFTWARE.
 #include <netuno/common.h>
 #include <netuno/symbol.h>
 #include <netuno/table.h>
+#include <stdatomic.h>
 
 #define IS_VALID_OBJECT(obj) ((obj) && IS_VALID_TYPE(((NT_OBJECT *)(obj))->type))
 
@@ -45,7 +46,9 @@ typedef bool (*nativeFun)(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType);
 struct _NT_OBJECT
 {
     const NT_TYPE *type;
-    size_t refCount;
+    // Zero for constants. Interned strings are shared between threads and count atomically,
+    // every other object belongs to the thread that created it and counts with plain stores.
+    _Atomic size_t refCount;
 };
 
 const NT_TYPE *ntObjectType(void);
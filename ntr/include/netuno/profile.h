@@ -0,0 +1,52 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_PROFILE_H
+#define NT_PROFILE_H
+
+#include <netuno/vm.h>
+#include <stdio.h>
+
+// frames kept of each sample, the outermost ones of deeper calls are dropped
+#define NT_PROFILE_DEPTH 64
+// samples a profile holds, the ones after it is full are lost
+#define NT_PROFILE_SAMPLES (1 << 16)
+
+typedef struct _NT_PROFILE NT_PROFILE;
+
+// Samples the call stack of the VM every interval microseconds of CPU time of the calling
+// thread, which is the one that runs the VM. A SIGPROF timer does the sampling, so the VM pays
+// nothing for it and nothing at all while no profile runs. The VM stays interpreted meanwhile,
+// see NT_INTERPRET, and time in traces counts for their loop. Linux only, NULL elsewhere or when
+// the timer could not be created.
+NT_PROFILE *ntStartProfile(NT_VM *vm, uint32_t interval);
+// stops the sampling, on the thread that started it
+void ntStopProfile(NT_PROFILE *profile);
+// Writes the samples as collapsed stacks, one "module.function:line;..." line from the root
+// with its count, which flame graph tools read.
+bool ntWriteProfile(const NT_PROFILE *profile, FILE *file);
+// stops the profile if needed and frees it
+void ntFreeProfile(NT_PROFILE *profile);
+
+#endif
@@ -36,11 +36,16 @@ struct _NT_STRING
     size_t length;
     char_t *chars;
     uint32_t hash;
+    // in the intern table, which a string leaves under the lock of its shard
+    bool interned;
 };
 
 const NT_TYPE *ntStringType(void);
 const NT_STRING *ntCopyString(const char_t *chars, const size_t length);
 const NT_STRING *ntTakeString(char_t *chars, const size_t length);
+// Drops a reference to a string, called by ntFreeObject. The last one is dropped under the lock
+// of the intern table, which never hands out a string being freed.
+void ntReleaseString(const NT_STRING *string);
 bool ntStrEquals(const char_t *str1, const char_t *str2);
 bool ntStrEqualsFixed(const char_t *str1, const size_t size1, const char_t *str2,
                       const size_t size2);
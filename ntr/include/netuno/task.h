@@ -0,0 +1,48 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_TASK_H
+#define NT_TASK_H
+
+#include <netuno/assembly.h>
+#include <netuno/module.h>
+
+// Native module running functions from int to int on worker threads that steal work from each
+// other:
+//
+//     var handle = task.spawn(f, arg)
+//     var result = task.join(handle)
+//
+// A task runs on a VM of its worker's pool, and join runs other tasks while it waits. Handles
+// are valid for one join, any other value makes join a runtime error. spawn is a runtime error
+// too unless the host froze the assembly before running it, see ntFreezeAssembly.
+const NT_MODULE *ntTaskModule(void);
+// true when the assembly refers to spawn, so it must be frozen before it runs
+bool ntAssemblySpawns(const NT_ASSEMBLY *assembly);
+// Stops the workers once their current tasks finish and frees the tasks nobody joined, and the
+// VMs tasks ran on in the calling thread. No VM may be running tasks meanwhile. Spawning again
+// starts new workers.
+void ntStopTasks(void);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_TRACELOG_H
+#define NT_TRACELOG_H
+
+#include <netuno/vm.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+// entries ntc keeps with --trace
+#define NT_TRACE_LOG_SIZE (1 << 20)
+
+// an instruction the interpreter dispatched
+typedef struct
+{
+    const NT_MODULE *module;
+    // of the instruction in the translated code of the module
+    uint32_t index;
+    // bytes on the operand stack, with the slot the interpreter may cache
+    uint32_t depth : 24;
+    uint32_t opcode : 8;
+} NT_TRACE_ENTRY;
+
+// Ring of the latest instructions of a VM. Only the thread running the VM writes it, others may
+// read it meanwhile without locks, see ntReadTraceLog.
+struct _NT_TRACE_LOG
+{
+    // entries ever written, the latest at (head - 1) & mask
+    _Atomic uint64_t head;
+    size_t mask;
+    NT_TRACE_ENTRY *entries;
+};
+
+// capacity is rounded up to a power of two
+NT_TRACE_LOG *ntCreateTraceLog(size_t capacity);
+void ntFreeTraceLog(NT_TRACE_LOG *log);
+// Logs the instructions of the VM, or stops when log is NULL, from the next time its interpreter
+// loop starts: ntRun, ntContinue, ntInvoke or a resume. A logging VM stays interpreted, see
+// NT_INTERPRET, and does not enter traces either.
+void ntSetTraceLog(NT_VM *vm, NT_TRACE_LOG *log);
+// Copies up to count of the latest entries, oldest first, and returns how many. Entries the VM
+// overwrote during the copy are left out.
+size_t ntReadTraceLog(const NT_TRACE_LOG *log, NT_TRACE_ENTRY *entries, size_t count);
+// Writes the entries for trace-decode.py, with the bytecode offset and line of each. The modules
+// they ran must still be alive.
+bool ntWriteTraceLog(const NT_TRACE_LOG *log, FILE *file);
+
+static inline void ntLogInstruction(NT_TRACE_LOG *log, const NT_MODULE *module,
+                                    const NT_INSTRUCTION *instruction, const size_t depth)
+{
+    const uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+    NT_TRACE_ENTRY *entry = &log->entries[head & log->mask];
+    entry->module = module;
+    entry->index = (uint32_t)(instruction - module->instructions);
+    entry->depth = (uint32_t)depth;
+    entry->opcode = instruction->opcode;
+    atomic_store_explicit(&log->head, head + 1, memory_order_release);
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef NT_VERIFIER_H
+#define NT_VERIFIER_H
+
+#include <netuno/common.h>
+
+typedef struct _NT_DELEGATE NT_DELEGATE;
+typedef struct _NT_INSTRUCTION NT_INSTRUCTION;
+
+// Proves that every path through a function keeps its stack inside the frame, agrees on the
+// depth where paths join and returns with exactly its return value left. instructions[begin,
+// end) is the decoded function body, its branches still hold compact pcs mapped by indices.
+// maxStack receives how many bytes the function grows above its arguments.
+bool ntVerifyFunction(const NT_DELEGATE *delegate, const NT_INSTRUCTION *instructions,
+                      const size_t *indices, size_t begin, size_t end, size_t *maxStack);
+
+#endif
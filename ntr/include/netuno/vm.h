@@ -26,13 +26,50 @@ SOFTWARE.
 #define NT_NTR_H
 
 #include <netuno/assembly.h>
+#include <signal.h>
 
 #ifndef NDEBUG
 #define DEBUG_TRACE_EXECUTION
 #endif
 
-#define STACK_MAX 4096
-#define CALL_STACK_MAX 4096
+// Build with NT_OPCODE_COUNTS to count the opcodes every VM runs, and their pairs and triples.
+// ntFreeVM writes them to stderr, see ntWriteOpcodeCounts, and task.join merges those of the
+// task into the joining VM. Such builds have no JIT.
+#ifdef NT_OPCODE_COUNTS
+typedef struct _NT_OPCODE_PROFILE NT_OPCODE_PROFILE;
+#endif
+
+// stacks start at their size and double on demand up to their limit, both in bytes
+#define NT_STACK_SIZE 1024
+#define NT_STACK_LIMIT (1024 * 1024)
+#define NT_CALL_STACK_SIZE 1024
+#define NT_CALL_STACK_LIMIT (1024 * 1024)
+// calls nested through ntInvoke, each of them runs on the native stack
+#define NT_INVOKE_LIMIT 8192
+// fuel of a VM that is not metered, which no run could burn
+#define NT_FUEL_UNLIMITED UINT64_MAX
+
+#if defined(__linux__) && !defined(NT_NO_GUARD_PAGES)
+#define NT_GUARD_PAGES
+#endif
+
+typedef enum
+{
+    // Maps both stacks at their limit below a PROT_NONE guard, so calls skip their overflow
+    // checks and a fault in the guard ends ntRun with NT_STACK_OVERFLOW. Linux only, ignored
+    // elsewhere.
+    NT_VM_GUARD_PAGES = 1 << 0,
+} NT_VM_FLAGS;
+
+typedef struct
+{
+    size_t stackSize;
+    size_t stackLimit;
+    size_t callStackSize;
+    size_t callStackLimit;
+    size_t invokeLimit;
+    uint32_t flags;
+} NT_VM_CONFIG;
 
 typedef enum
 {
@@ -40,29 +77,141 @@ typedef enum
     NT_COMPILE_ERROR,
     NT_RUNTIME_ERROR,
     NT_STACK_OVERFLOW,
+    // out of fuel, ntContinue goes on from there
+    NT_YIELD,
 } NT_RESULT;
 
+typedef struct _NT_FIBER NT_FIBER;
+
+// Reasons for a VM to stay out of functions compiled by the JIT, which run on the native stack
+// and leave neither frames nor charges behind. Traces run still, but leave before their calls.
+typedef enum
+{
+    NT_INTERPRET_FUEL = 1 << 0,
+    NT_INTERPRET_PROFILE = 1 << 1,
+    NT_INTERPRET_LOG = 1 << 2,
+} NT_INTERPRET;
+
+typedef struct _NT_TRACE_LOG NT_TRACE_LOG;
+
+// a call in progress, pc is the instruction after the one it is at
+typedef struct
+{
+    const NT_INSTRUCTION *pc;
+    const NT_MODULE *module;
+} NT_FRAME;
+
 typedef struct _NT_VM
 {
     const NT_MODULE *module;
     NT_ASSEMBLY *assembly;
-    size_t pc;
+    const NT_INSTRUCTION *pc;
     uint8_t *stack;
     uint8_t *stackTop;
+    uint8_t *stackEnd;
+    size_t stackLimit;
     uint8_t *callStack;
     uint8_t *callStackTop;
+    uint8_t *callStackEnd;
+    size_t callStackLimit;
+    size_t invokeDepth;
+    size_t invokeLimit;
+    // charged by backward branches and calls, see ntSetFuel
+    uint64_t fuel;
+    // NT_INTERPRET flags
+    uint8_t interpret;
+    bool guarded;
     bool stackOverflow;
+    // the fiber running on the stacks, NULL for the VM's own
+    NT_FIBER *fiber;
+    // odd while a call, return or fiber switch changes the call stack, pc and module, see
+    // ntBacktrace
+    volatile sig_atomic_t sequence;
+    // where the interpreter logs its instructions, see ntSetTraceLog
+    NT_TRACE_LOG *traceLog;
 #ifdef DEBUG_TRACE_EXECUTION
     size_t *stackType;
     size_t *stackTypeTop;
 #endif
+#ifdef NT_OPCODE_COUNTS
+    NT_OPCODE_PROFILE *counts;
+#endif
 } NT_VM;
 
-NT_VM *ntCreateVM(void);
+typedef enum
+{
+    NT_FIBER_NEW,
+    NT_FIBER_RUNNING,
+    NT_FIBER_SUSPENDED,
+    NT_FIBER_DONE,
+    NT_FIBER_FAILED,
+} NT_FIBER_STATE;
+
+// A call with stacks of its own. Resuming a fiber swaps its stacks with those of the VM, and a
+// yield swaps them back, so a switch costs the same whatever the depth of either call. While a
+// fiber runs, the fields hold the stacks of the one that resumed it.
+struct _NT_FIBER
+{
+    NT_FIBER_STATE state;
+    const NT_DELEGATE *entryPoint;
+    // the value passed by the last resume or yield
+    uint32_t value;
+    // the fiber it returns to, and the native nesting a yield has to be at
+    NT_FIBER *caller;
+    size_t invokeDepth;
+    const NT_MODULE *module;
+    const NT_INSTRUCTION *pc;
+    uint8_t *stack;
+    uint8_t *stackTop;
+    uint8_t *stackEnd;
+    size_t stackLimit;
+    uint8_t *callStack;
+    uint8_t *callStackTop;
+    uint8_t *callStackEnd;
+    size_t callStackLimit;
+    bool guarded;
+    // an event loop waiter holds it, so only the loop may resume it and no one may free it
+    bool parked;
+#ifdef DEBUG_TRACE_EXECUTION
+    size_t *stackType;
+    size_t *stackTypeTop;
+#endif
+};
+
+// config may be NULL to use the default stack sizes
+NT_VM *ntCreateVM(const NT_VM_CONFIG *config);
 void ntFreeVM(NT_VM *vm);
 
+// Idle VMs kept allocated between short runs. A pool is not synchronised, each thread should
+// own the pool it acquires from.
+typedef struct
+{
+    NT_VM_CONFIG config;
+    NT_ARRAY idle;
+} NT_VM_POOL;
+
+// creates count VMs up front, config may be NULL like for ntCreateVM
+NT_VM_POOL *ntCreateVMPool(const NT_VM_CONFIG *config, size_t count);
+void ntFreeVMPool(NT_VM_POOL *pool);
+// hands out an idle VM, creating one when the pool ran out
+NT_VM *ntAcquireVM(NT_VM_POOL *pool);
+// resets the VM and keeps it for the next ntAcquireVM
+void ntReleaseVM(NT_VM_POOL *pool, NT_VM *vm);
+
 NT_RESULT ntRun(NT_VM *vm, NT_ASSEMBLY *assembly, const NT_DELEGATE *entryPoint);
+// Gives the VM fuel for that many backward branches and calls, NT_FUEL_UNLIMITED ends the
+// metering. Running out stops ntRun or ntContinue with NT_YIELD at the next of them outside of
+// natives and fibers, which nest on the native stack. Metered VMs stay interpreted, see
+// NT_INTERPRET.
+// The host only gets control back at that outermost level: a loop inside a fiber or under a
+// nested ntInvoke keeps running on an empty tank until it returns there, and a loop that never
+// does never yields. Tasks run on VMs of their own, which are not metered.
+void ntSetFuel(NT_VM *vm, uint64_t fuel);
+// goes on with a run that returned NT_YIELD
+NT_RESULT ntContinue(NT_VM *vm);
 
+// Pops everything off both stacks and forgets the assembly, the fuel, the profile and the trace
+// log, so the VM can run another.
 void ntResetStack(NT_VM *vm);
 bool ntPush(NT_VM *vm, const void *data, const size_t dataSize);
 bool ntPop(NT_VM *vm, void *data, const size_t dataSize);
@@ -73,5 +222,24 @@ bool ntPopRef(NT_VM *vm, NT_REF *value);
 bool ntPop64(NT_VM *vm, uint64_t *value);
 bool ntPush64(NT_VM *vm, const uint64_t value);
 bool ntCall(NT_VM *vm, const NT_DELEGATE *delegate);
+// Calls a delegate from native code and returns once it has returned.
+bool ntInvoke(NT_VM *vm, const NT_DELEGATE *delegate);
+// Copies up to count frames of the running call, innermost first, and returns how many. It only
+// reads the VM, so a signal handler that interrupted the thread running it can call it, and it
+// returns 0 midway through a call, a return or a fiber switch, whose frames would not match.
+size_t ntBacktrace(const NT_VM *vm, NT_FRAME *frames, size_t count);
+
+// A fiber calls entryPoint, a function from int to int, with the value of its first resume.
+// config may be NULL like for ntCreateVM, its flags are ignored.
+NT_FIBER *ntCreateFiber(const NT_VM_CONFIG *config, const NT_DELEGATE *entryPoint);
+void ntFreeFiber(NT_FIBER *fiber);
+// For natives returning int. Runs the fiber until it yields or returns, and pushes that value
+// as the result of the native. Fails for a fiber that is running, finished or parked.
+bool ntResume(NT_VM *vm, NT_FIBER *fiber, const uint32_t value);
+// Suspends the running fiber, for natives returning int that popped their arguments already.
+// The native returns right away, and once the fiber is resumed again the value of that resume
+// is its result. Code compiled by the JIT nests on the native stack, which a fiber does not
+// keep, so fibers run interpreted and can only yield from natives called by the interpreter.
+bool ntYield(NT_VM *vm, const uint32_t value);
 
 #endif
@@ -24,9 +24,15 @@ SOFTWARE.
 */
 #include <assert.h>
 #include <netuno/assembly.h>
+#include <netuno/console.h>
+#include <netuno/fiber.h>
+#include <netuno/instruction.h>
+#include <netuno/io.h>
 #include <netuno/memory.h>
+#include <netuno/module.h>
 #include <netuno/str.h>
 #include <netuno/string.h>
+#include <netuno/task.h>
 
 static bool refEquals(NT_OBJECT *obj1, NT_OBJECT *obj2)
 {
@@ -100,6 +106,7 @@ NT_ASSEMBLY *ntCreateAssembly(void)
 {
     NT_ASSEMBLY *assembly = (NT_ASSEMBLY *)ntCreateObject(ntAssemblyType());
     assembly->objects = ntCreateArray();
+    assembly->frozen = false;
     return assembly;
 }
 
@@ -174,3 +181,50 @@ NT_OBJECT *ntGetConstantObject(const NT_ASSEMBLY *assembly, uint64_t constant)
     assert(result);
     return object;
 }
+
+// the getters initialise on first use, which is only safe while a single thread runs
+static void initBuiltins(void)
+{
+    ntType();
+    ntObjectType();
+    ntBoolType();
+    ntI32Type();
+    ntI64Type();
+    ntU32Type();
+    ntU64Type();
+    ntF32Type();
+    ntF64Type();
+    ntUndefinedType();
+    ntVoidType();
+    ntErrorType();
+    ntStringType();
+    ntDelegateType();
+    ntModuleType();
+    ntAssemblyType();
+    ntConsoleModule();
+    ntTaskModule();
+    ntFiberModule();
+    ntIoModule();
+}
+
+bool ntFreezeAssembly(NT_ASSEMBLY *assembly)
+{
+    assert(assembly);
+    if (assembly->frozen)
+        return true;
+
+    initBuiltins();
+    if (!ntTranslateAssembly(assembly))
+        return false;
+
+    for (size_t i = 0; i < assembly->objects->count / sizeof(NT_REF); ++i)
+    {
+        NT_OBJECT *object = ntGetConstantObject(assembly, i);
+        if (object->type->objectType == NT_OBJECT_TYPE_TYPE &&
+            ((NT_TYPE *)object)->objectType == NT_OBJECT_MODULE)
+            ntFreezeModule((NT_MODULE *)object);
+    }
+
+    assembly->frozen = true;
+    return true;
+}
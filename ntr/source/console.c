@@ -24,6 +24,7 @@ SOFTWARE.
 */
 #include <assert.h>
 #include <netuno/console.h>
+#include <netuno/io.h>
 #include <netuno/memory.h>
 #include <netuno/native.h>
 #include <netuno/str.h>
@@ -31,6 +32,11 @@ SOFTWARE.
 #include <netuno/vm.h>
 #include <stdio.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#endif
+
 static NT_MODULE CONSOLE = {
     .type.object =
         {
@@ -72,6 +78,24 @@ static void addWrite(void)
         ntCreateNativeFunction(&CONSOLE, U"write", NULL, 1, &param, consoleWrite, true);
 }
 
+#ifndef _WIN32
+// a byte at a time, so no input is left in a buffer the descriptor does not know of
+static int readChar(void)
+{
+    unsigned char c;
+    ssize_t count;
+    do
+        count = read(STDIN_FILENO, &c, 1);
+    while (count < 0 && errno == EINTR);
+    return count == 1 ? c : EOF;
+}
+#else
+static int readChar(void)
+{
+    return fgetc(stdin);
+}
+#endif
+
 static const NT_DELEGATE_TYPE *ConsoleReadLineType = NULL;
 static bool consoleReadline(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
 {
@@ -79,6 +103,12 @@ static bool consoleReadline(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
     assert(delegateType);
     assert(delegateType == ConsoleReadLineType);
 
+#ifndef _WIN32
+    // fibers parked on the event loop keep running while the line is typed
+    if (!ntAwaitFd(vm, STDIN_FILENO, NT_IO_READ))
+        return false;
+#endif
+
     size_t lenmax = 256, len = lenmax;
     char *line = ntMalloc(lenmax), *linep = line;
     int c;
@@ -88,7 +118,7 @@ static bool consoleReadline(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
 
     for (;;)
     {
-        c = fgetc(stdin);
+        c = readChar();
         if (c == EOF)
             break;
 
@@ -24,12 +24,16 @@ SOFTWARE.
 */
 #include <assert.h>
 #include <netuno/debug.h>
+#include <netuno/instruction.h>
 #include <netuno/memory.h>
 #include <netuno/module.h>
 #include <netuno/opcode.h>
 #include <netuno/str.h>
 #include <netuno/string.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char *const labels[] = {
 #define bytecode(a) #a,
@@ -45,6 +49,19 @@ void ntDisassembleModule(const NT_ASSEMBLY *assembly, const NT_MODULE *module, c
         i = ntDisassembleInstruction(assembly, module, i);
 }
 
+static void printLine(const NT_MODULE *module, const size_t offset)
+{
+    printf("%04ld ", offset);
+
+    bool atStart;
+    int64_t line = ntGetLine(module, offset, &atStart);
+
+    if (atStart)
+        printf("%4ld ", line + 1);
+    else
+        printf("   | ");
+}
+
 static size_t simpleInstruction(const char *name, const size_t offset)
 {
     printf("%s\n", name);
@@ -106,18 +123,28 @@ static size_t constantObjectInstruction(const char *name, const NT_ASSEMBLY *ass
     return readed + 1;
 }
 
-size_t ntDisassembleInstruction(const NT_ASSEMBLY *assembly, const NT_MODULE *module,
-                                const size_t offset)
+static size_t tailCallInstruction(const char *name, const NT_ASSEMBLY *assembly,
+                                  const NT_MODULE *module, const size_t offset)
 {
-    printf("%04ld ", offset);
+    uint64_t constant;
+    uint64_t frameSize;
+    const size_t readed = ntReadVariant(module, offset + 1, &constant);
+    const size_t readed2 = ntReadVariant(module, offset + 1 + readed, &frameSize);
+    printf("%-16s %4ld '", name, constant);
 
-    bool atStart;
-    int64_t line = ntGetLine(module, offset, &atStart);
+    const NT_STRING *string = ntToString(ntGetConstantObject(assembly, constant));
+    char *str = ntToCharFixed(string->chars, string->length);
+    ntFreeObject((NT_OBJECT *)string);
+    printf("%s %4ld\n", str, frameSize * sizeof(uint32_t));
+    ntFree(str);
 
-    if (atStart)
-        printf("%4ld ", line + 1);
-    else
-        printf("   | ");
+    return readed + readed2 + 1;
+}
+
+size_t ntDisassembleInstruction(const NT_ASSEMBLY *assembly, const NT_MODULE *module,
+                                const size_t offset)
+{
+    printLine(module, offset);
 
     uint8_t instruction;
     const size_t size = ntArrayGet(&module->code, offset, &instruction, sizeof(uint8_t));
@@ -133,7 +160,10 @@ size_t ntDisassembleInstruction(const NT_ASSEMBLY *assembly, const NT_MODULE *mo
         case BC_CONST_64:
             return constant64Instruction(label, module, offset);
         case BC_CONST_OBJECT:
+        case BC_CALL_DIRECT:
             return constantObjectInstruction(label, assembly, module, offset);
+        case BC_TAIL_CALL:
+            return tailCallInstruction(label, assembly, module, offset);
         case BC_POP:
             return popInstruction(label, module, offset);
         default:
@@ -146,3 +176,231 @@ size_t ntDisassembleInstruction(const NT_ASSEMBLY *assembly, const NT_MODULE *mo
         return offset + 1;
     }
 }
+
+static void printObject(const char *name, NT_OBJECT *object)
+{
+    const NT_STRING *string = ntToString(object);
+
+    char *str = ntToCharFixed(string->chars, string->length);
+    ntFreeObject((NT_OBJECT *)string);
+    printf("%-16s '%s\n", name, str);
+    ntFree(str);
+}
+
+void ntDisassembleTranslated(const NT_MODULE *module, const NT_INSTRUCTION *instruction)
+{
+    printLine(module, ntInstructionPc(module, instruction));
+
+    if (instruction->opcode >= BC_LAST)
+    {
+        printf("Unknown opcode %d\n", instruction->opcode);
+        return;
+    }
+
+    const char *label = labels[instruction->opcode];
+    switch (instruction->opcode)
+    {
+    case BC_CONST_32:
+        printf("%-16s '%d\n", label, instruction->value32);
+        break;
+    case BC_CONST_64:
+        printf("%-16s '%" PRId64 "\n", label, (int64_t)instruction->value64);
+        break;
+    case BC_CONST_OBJECT:
+    case BC_CALL_DIRECT:
+        printObject(label, instruction->object);
+        break;
+    case BC_TAIL_CALL: {
+        const NT_STRING *string = ntToString(instruction->object);
+        char *str = ntToCharFixed(string->chars, string->length);
+        ntFreeObject((NT_OBJECT *)string);
+        printf("%-16s '%s %4d\n", label, str, instruction->operand);
+        ntFree(str);
+        break;
+    }
+    case BC_BRANCH:
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_32:
+    case BC_BRANCH_NZ_64:
+    case BC_EQ_32_BRANCH_Z:
+    case BC_NE_32_BRANCH_Z:
+    case BC_GT_I32_BRANCH_Z:
+    case BC_GT_U32_BRANCH_Z:
+    case BC_LT_I32_BRANCH_Z:
+    case BC_LT_U32_BRANCH_Z:
+    case BC_GE_I32_BRANCH_Z:
+    case BC_GE_U32_BRANCH_Z:
+    case BC_LE_I32_BRANCH_Z:
+    case BC_LE_U32_BRANCH_Z:
+        printf("%-16s %04ld\n", label, ntInstructionPc(module, instruction->target));
+        break;
+    case BC_POP:
+    case BC_POP_RETURN:
+        printf("%-16s '%d\n", label, instruction->operand);
+        break;
+    case BC_LOAD_SP_32:
+    case BC_LOAD_SP_64:
+    case BC_STORE_SP_32:
+    case BC_STORE_SP_64:
+        printf("%-16s %4d\n", label, instruction->operand);
+        break;
+    case BC_ADD_SP_SP_I32:
+    case BC_SUB_SP_SP_I32:
+        printf("%-16s %4d %4d\n", label, instruction->operand, instruction->value32);
+        break;
+    case BC_ADD_SP_CONST_I32:
+    case BC_SUB_SP_CONST_I32:
+        printf("%-16s %4d '%d\n", label, instruction->operand, instruction->value32);
+        break;
+    case BC_RETURN_32:
+    case BC_RETURN_64:
+        printf("%-16s %4d '%d\n", label, instruction->operand, instruction->value32);
+        break;
+    case BC_REG_ADJUST:
+        printf("%-16s %+d\n", label, instruction->delta);
+        break;
+    case BC_REG_MOVE_32:
+        printf("%-16s %4d %4d %+d\n", label, instruction->dst, instruction->left,
+               instruction->delta);
+        break;
+    case BC_REG_MOVE_32_K:
+        printf("%-16s %4d '%d %+d\n", label, instruction->dst, instruction->right,
+               instruction->delta);
+        break;
+    case BC_REG_ADD_I32:
+    case BC_REG_SUB_I32:
+    case BC_REG_MUL_I32:
+    case BC_REG_EQ_32:
+    case BC_REG_NE_32:
+    case BC_REG_GT_I32:
+    case BC_REG_GT_U32:
+    case BC_REG_LT_I32:
+    case BC_REG_LT_U32:
+    case BC_REG_GE_I32:
+    case BC_REG_GE_U32:
+    case BC_REG_LE_I32:
+    case BC_REG_LE_U32:
+        printf("%-16s %4d %4d %4d %+d\n", label, instruction->dst, instruction->left,
+               instruction->right, instruction->delta);
+        break;
+    case BC_REG_ADD_I32_K:
+    case BC_REG_SUB_I32_K:
+    case BC_REG_MUL_I32_K:
+    case BC_REG_EQ_32_K:
+    case BC_REG_NE_32_K:
+    case BC_REG_GT_I32_K:
+    case BC_REG_GT_U32_K:
+    case BC_REG_LT_I32_K:
+    case BC_REG_LT_U32_K:
+    case BC_REG_GE_I32_K:
+    case BC_REG_GE_U32_K:
+    case BC_REG_LE_I32_K:
+    case BC_REG_LE_U32_K:
+        printf("%-16s %4d %4d '%d %+d\n", label, instruction->dst, instruction->left,
+               instruction->right, instruction->delta);
+        break;
+    default:
+        printf("%s\n", label);
+        break;
+    }
+}
+
+#ifdef NT_OPCODE_COUNTS
+typedef struct
+{
+    uint8_t length;
+    uint8_t opcodes[3];
+    uint64_t count;
+} COUNT_ROW;
+
+static int compareRows(const void *a, const void *b)
+{
+    const COUNT_ROW *row1 = (const COUNT_ROW *)a;
+    const COUNT_ROW *row2 = (const COUNT_ROW *)b;
+    if (row1->length != row2->length)
+        return row1->length < row2->length ? -1 : 1;
+    if (row1->count != row2->count)
+        return row1->count > row2->count ? -1 : 1;
+    return memcmp(row1->opcodes, row2->opcodes, sizeof(row1->opcodes));
+}
+
+NT_OPCODE_PROFILE *ntCreateOpcodeCounts(void)
+{
+    NT_OPCODE_PROFILE *counts = (NT_OPCODE_PROFILE *)ntMalloc(sizeof(NT_OPCODE_PROFILE));
+    memset(counts, 0, sizeof(NT_OPCODE_PROFILE));
+    return counts;
+}
+
+void ntMergeOpcodeCounts(NT_OPCODE_PROFILE *into, const NT_OPCODE_PROFILE *from)
+{
+    for (size_t i = 0; i < BC_LAST; ++i)
+    {
+        into->opcodes[i] += from->opcodes[i];
+        for (size_t j = 0; j < BC_LAST; ++j)
+            into->pairs[i][j] += from->pairs[i][j];
+    }
+    for (size_t i = 0; i < NT_OPCODE_TRIPLES; ++i)
+    {
+        if (from->triples[i].key)
+            ntCountOpcodeTriple(into, from->triples[i].key, from->triples[i].count);
+    }
+    into->lost += from->lost;
+}
+
+void ntWriteOpcodeCounts(const NT_OPCODE_PROFILE *counts, FILE *file)
+{
+    NT_ARRAY rows;
+    ntInitArray(&rows);
+    for (size_t i = 0; i < BC_LAST; ++i)
+    {
+        if (counts->opcodes[i])
+        {
+            const COUNT_ROW row = {1, {(uint8_t)i}, counts->opcodes[i]};
+            ntArrayAdd(&rows, &row, sizeof(COUNT_ROW));
+        }
+        for (size_t j = 0; j < BC_LAST; ++j)
+        {
+            if (counts->pairs[i][j])
+            {
+                const COUNT_ROW row = {2, {(uint8_t)i, (uint8_t)j}, counts->pairs[i][j]};
+                ntArrayAdd(&rows, &row, sizeof(COUNT_ROW));
+            }
+        }
+    }
+    for (size_t i = 0; i < NT_OPCODE_TRIPLES; ++i)
+    {
+        const NT_OPCODE_TRIPLE *triple = &counts->triples[i];
+        if (triple->key)
+        {
+            const COUNT_ROW row = {
+                3,
+                {
+                    (uint8_t)((triple->key >> 16) - 1),
+                    (uint8_t)(((triple->key >> 8) & 0xFF) - 1),
+                    (uint8_t)((triple->key & 0xFF) - 1),
+                },
+                triple->count,
+            };
+            ntArrayAdd(&rows, &row, sizeof(COUNT_ROW));
+        }
+    }
+
+    const size_t count = rows.count / sizeof(COUNT_ROW);
+    qsort(rows.data, count, sizeof(COUNT_ROW), compareRows);
+
+    static const char *const kinds[] = {NULL, "opcode", "pair", "triple"};
+    fprintf(file, "kind,first,second,third,count\n");
+    for (size_t i = 0; i < count; ++i)
+    {
+        const COUNT_ROW *row = &((const COUNT_ROW *)rows.data)[i];
+        fprintf(file, "%s", kinds[row->length]);
+        for (size_t j = 0; j < 3; ++j)
+            fprintf(file, ",%s", j < row->length ? labels[row->opcodes[j]] : "");
+        fprintf(file, ",%" PRIu64 "\n", row->count);
+    }
+    if (counts->lost)
+        fprintf(file, "lost,,,,%" PRIu64 "\n", counts->lost);
+    ntDeinitArray(&rows);
+}
+#endif
@@ -24,6 +24,7 @@ SOFTWARE.
 */
 #include <assert.h>
 #include <netuno/delegate.h>
+#include <netuno/jit.h>
 #include <netuno/memory.h>
 #include <netuno/module.h>
 #include <netuno/object.h>
@@ -94,12 +95,22 @@ static void freeDelegate(NT_OBJECT *object)
 {
     assert(object->type->objectType == NT_OBJECT_DELEGATE);
     NT_DELEGATE *delegate = (NT_DELEGATE *)object;
+#ifdef NT_JIT
+    if (!delegate->native)
+        ntJitFree(delegate);
+#endif
     ntFreeObject((NT_OBJECT *)delegate->name);
     delegate->name = NULL;
     delegate->native = false;
     delegate->func = NULL;
     delegate->addr = 0;
     delegate->sourceModule = NULL;
+    delegate->entry = NULL;
+    delegate->maxStack = 0;
+    delegate->calls = 0;
+    delegate->jit = NULL;
+    delegate->paramsSize = 0;
+    delegate->returnSize = 0;
 }
 
 static const NT_STRING *delegateToString(NT_OBJECT *object)
@@ -162,6 +173,15 @@ char_t *ntDelegateTypeName(const NT_TYPE *returnType, size_t paramCount, const N
     return ntRealloc(array.data, array.count);
 }
 
+// computed once here so calls never walk the parameter list
+static void frameSizes(NT_DELEGATE *delegate, const NT_DELEGATE_TYPE *delegateType)
+{
+    delegate->paramsSize = 0;
+    for (size_t i = 0; i < delegateType->paramCount; ++i)
+        delegate->paramsSize += delegateType->params[i].type->stackSize;
+    delegate->returnSize = delegateType->returnType ? delegateType->returnType->stackSize : 0;
+}
+
 const NT_DELEGATE *ntDelegate(const NT_DELEGATE_TYPE *delegateType, const NT_MODULE *module,
                               size_t addr, const NT_STRING *name)
 {
@@ -180,7 +200,12 @@ const NT_DELEGATE *ntDelegate(const NT_DELEGATE_TYPE *delegateType, const NT_MOD
     delegate->native = false;
     delegate->addr = addr;
     delegate->sourceModule = module;
+    delegate->entry = NULL;
+    delegate->maxStack = 0;
+    delegate->calls = 0;
+    delegate->jit = NULL;
     delegate->name = name;
+    frameSizes(delegate, delegateType);
 
     return delegate;
 }
@@ -200,6 +225,7 @@ const NT_DELEGATE *ntNativeDelegate(const NT_DELEGATE_TYPE *delegateType, native
     delegate->native = true;
     delegate->func = func;
     delegate->name = name;
+    frameSizes(delegate, delegateType);
 
     return delegate;
 }
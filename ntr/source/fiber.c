@@ -0,0 +1,208 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/fiber.h>
+#include <netuno/handle.h>
+#include <netuno/memory.h>
+#include <netuno/native.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <netuno/vm.h>
+
+static NT_MODULE FIBER_MODULE = {
+    .type.object =
+        {
+            .type = NULL,
+        },
+};
+
+// fibers switch the stacks of the VM they run on, so each thread has its own
+static _Thread_local NT_HANDLES fibers = {
+    .slots = NULL, .count = 0, .capacity = 0, .firstFree = NT_NO_SLOT};
+
+// a freed or forged handle fails the call
+static bool popFiber(NT_VM *vm, uint64_t *handle, NT_FIBER **fiber)
+{
+    if (!ntPop64(vm, handle))
+        return false;
+    *fiber = (NT_FIBER *)ntGetHandle(&fibers, *handle);
+    return *fiber != NULL;
+}
+
+static const NT_DELEGATE_TYPE *FiberCreateType = NULL;
+static bool fiberCreate(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == FiberCreateType);
+
+    NT_OBJECT *object;
+    if (!ntPopRef(vm, (NT_REF *)&object))
+        return false;
+
+    // the parameter is an object, so the signature is only known now
+    if (object->type->objectType != NT_OBJECT_DELEGATE)
+        return false;
+    const NT_DELEGATE_TYPE *type = (const NT_DELEGATE_TYPE *)object->type;
+    if (type->paramCount != 1 || type->params[0].type != ntI32Type() ||
+        type->returnType != ntI32Type())
+        return false;
+
+    NT_FIBER *fiber = ntCreateFiber(NULL, (const NT_DELEGATE *)object);
+    return ntPush64(vm, ntAddHandle(&fibers, fiber));
+}
+
+static void addCreate(void)
+{
+    const NT_PARAM param = {
+        .type = ntObjectType(),
+        .name = ntCopyString(U"function", 8),
+    };
+
+    FiberCreateType = ntCreateNativeFunction(&FIBER_MODULE, U"create", ntI64Type(), 1, &param,
+                                             fiberCreate, true);
+}
+
+static const NT_DELEGATE_TYPE *FiberResumeType = NULL;
+static bool fiberResume(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == FiberResumeType);
+
+    uint32_t value;
+    uint64_t handle;
+    NT_FIBER *fiber;
+    return ntPop32(vm, &value) && popFiber(vm, &handle, &fiber) && ntResume(vm, fiber, value);
+}
+
+static void addResume(void)
+{
+    const NT_PARAM params[] = {
+        {
+            .type = ntI64Type(),
+            .name = ntCopyString(U"handle", 6),
+        },
+        {
+            .type = ntI32Type(),
+            .name = ntCopyString(U"value", 5),
+        },
+    };
+
+    FiberResumeType = ntCreateNativeFunction(&FIBER_MODULE, U"resume", ntI32Type(), 2, params,
+                                             fiberResume, true);
+}
+
+static const NT_DELEGATE_TYPE *FiberYieldType = NULL;
+static bool fiberYield(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == FiberYieldType);
+
+    uint32_t value;
+    return ntPop32(vm, &value) && ntYield(vm, value);
+}
+
+static void addYield(void)
+{
+    const NT_PARAM param = {
+        .type = ntI32Type(),
+        .name = ntCopyString(U"value", 5),
+    };
+
+    FiberYieldType = ntCreateNativeFunction(&FIBER_MODULE, U"yield", ntI32Type(), 1, &param,
+                                            fiberYield, true);
+}
+
+static const NT_DELEGATE_TYPE *FiberDoneType = NULL;
+static bool fiberDone(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == FiberDoneType);
+
+    uint64_t handle;
+    NT_FIBER *fiber;
+    if (!popFiber(vm, &handle, &fiber))
+        return false;
+    const bool done = fiber->state == NT_FIBER_DONE || fiber->state == NT_FIBER_FAILED;
+    return ntPush32(vm, done);
+}
+
+static void addDone(void)
+{
+    const NT_PARAM param = {
+        .type = ntI64Type(),
+        .name = ntCopyString(U"handle", 6),
+    };
+
+    FiberDoneType = ntCreateNativeFunction(&FIBER_MODULE, U"done", ntBoolType(), 1, &param,
+                                           fiberDone, true);
+}
+
+static const NT_DELEGATE_TYPE *FiberFreeType = NULL;
+static bool fiberFree(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == FiberFreeType);
+
+    uint64_t handle;
+    NT_FIBER *fiber;
+    // a parked fiber is still referenced by the waiter that wakes it
+    if (!popFiber(vm, &handle, &fiber) || fiber->state == NT_FIBER_RUNNING || fiber->parked)
+        return false;
+    ntTakeHandle(&fibers, handle);
+    ntFreeFiber(fiber);
+    return true;
+}
+
+static void addFree(void)
+{
+    const NT_PARAM param = {
+        .type = ntI64Type(),
+        .name = ntCopyString(U"handle", 6),
+    };
+
+    FiberFreeType =
+        ntCreateNativeFunction(&FIBER_MODULE, U"free", NULL, 1, &param, fiberFree, true);
+}
+
+const NT_MODULE *ntFiberModule(void)
+{
+    if (FIBER_MODULE.type.object.type == NULL)
+    {
+        ntInitModule(&FIBER_MODULE);
+        ntMakeConstant((NT_OBJECT *)&FIBER_MODULE);
+        const char_t *moduleName = U"fiber";
+        FIBER_MODULE.type.typeName = ntCopyString(moduleName, ntStrLen(moduleName));
+        ntInitSymbolTable(&FIBER_MODULE.type.fields, (NT_SYMBOL_TABLE *)&ntType()->fields,
+                          STT_TYPE, NULL);
+
+        addCreate();
+        addResume();
+        addYield();
+        addDone();
+        addFree();
+    }
+
+    return &FIBER_MODULE;
+}
@@ -0,0 +1,87 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <netuno/handle.h>
+#include <netuno/memory.h>
+
+void ntInitHandles(NT_HANDLES *handles)
+{
+    handles->slots = NULL;
+    handles->count = 0;
+    handles->capacity = 0;
+    handles->firstFree = NT_NO_SLOT;
+}
+
+void ntDeinitHandles(NT_HANDLES *handles)
+{
+    ntFree(handles->slots);
+    ntInitHandles(handles);
+}
+
+uint64_t ntAddHandle(NT_HANDLES *handles, void *data)
+{
+    uint32_t index = handles->firstFree;
+    if (index != NT_NO_SLOT)
+        handles->firstFree = handles->slots[index].nextFree;
+    else
+    {
+        if (handles->count == handles->capacity)
+        {
+            handles->capacity = handles->capacity ? handles->capacity * 2 : 64;
+            handles->slots = (NT_HANDLE_SLOT *)ntRealloc(
+                handles->slots, handles->capacity * sizeof(NT_HANDLE_SLOT));
+        }
+        index = handles->count++;
+        handles->slots[index].generation = 1;
+    }
+    NT_HANDLE_SLOT *slot = &handles->slots[index];
+    slot->data = data;
+    slot->nextFree = NT_NO_SLOT;
+    return ((uint64_t)slot->generation << 32) | index;
+}
+
+void *ntGetHandle(const NT_HANDLES *handles, uint64_t handle)
+{
+    const uint32_t index = (uint32_t)handle;
+    const uint32_t generation = (uint32_t)(handle >> 32);
+    if (index >= handles->count || handles->slots[index].generation != generation)
+        return NULL;
+    return handles->slots[index].data;
+}
+
+void *ntTakeHandle(NT_HANDLES *handles, uint64_t handle)
+{
+    void *data = ntGetHandle(handles, handle);
+    if (!data)
+        return NULL;
+
+    const uint32_t index = (uint32_t)handle;
+    NT_HANDLE_SLOT *slot = &handles->slots[index];
+    slot->data = NULL;
+    // 0 is never a live generation, so the handle 0 is never valid
+    slot->generation = slot->generation == UINT32_MAX ? 1 : slot->generation + 1;
+    slot->nextFree = handles->firstFree;
+    handles->firstFree = index;
+    return data;
+}
@@ -0,0 +1,1362 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/instruction.h>
+#include <netuno/jit.h>
+#include <netuno/memory.h>
+#include <netuno/module.h>
+#include <netuno/opcode.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <netuno/symbol.h>
+#include <netuno/verifier.h>
+#include <stdio.h>
+
+static bool hasOperand(const uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case BC_CONST_32:
+    case BC_CONST_64:
+    case BC_CONST_OBJECT:
+    case BC_CALL_DIRECT:
+    case BC_TAIL_CALL:
+    case BC_BRANCH:
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_32:
+    case BC_BRANCH_NZ_64:
+    case BC_POP:
+    case BC_LOAD_SP_32:
+    case BC_LOAD_SP_64:
+    case BC_STORE_SP_32:
+    case BC_STORE_SP_64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isBranch(const uint32_t opcode)
+{
+    switch (opcode)
+    {
+    case BC_BRANCH:
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_32:
+    case BC_BRANCH_NZ_64:
+    case BC_EQ_32_BRANCH_Z:
+    case BC_NE_32_BRANCH_Z:
+    case BC_GT_I32_BRANCH_Z:
+    case BC_GT_U32_BRANCH_Z:
+    case BC_LT_I32_BRANCH_Z:
+    case BC_LT_U32_BRANCH_Z:
+    case BC_GE_I32_BRANCH_Z:
+    case BC_GE_U32_BRANCH_Z:
+    case BC_LE_I32_BRANCH_Z:
+    case BC_LE_U32_BRANCH_Z:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static uint32_t compareBranch(const uint32_t opcode)
+{
+    switch (opcode)
+    {
+    case BC_EQ_32:
+        return BC_EQ_32_BRANCH_Z;
+    case BC_NE_32:
+        return BC_NE_32_BRANCH_Z;
+    case BC_GT_I32:
+        return BC_GT_I32_BRANCH_Z;
+    case BC_GT_U32:
+        return BC_GT_U32_BRANCH_Z;
+    case BC_LT_I32:
+        return BC_LT_I32_BRANCH_Z;
+    case BC_LT_U32:
+        return BC_LT_U32_BRANCH_Z;
+    case BC_GE_I32:
+        return BC_GE_I32_BRANCH_Z;
+    case BC_GE_U32:
+        return BC_GE_U32_BRANCH_Z;
+    case BC_LE_I32:
+        return BC_LE_I32_BRANCH_Z;
+    case BC_LE_U32:
+        return BC_LE_U32_BRANCH_Z;
+    default:
+        return BC_LAST;
+    }
+}
+
+static bool isConst32(const uint32_t opcode)
+{
+    return opcode == BC_ZERO_32 || opcode == BC_ONE_32 || opcode == BC_CONST_32;
+}
+
+static size_t readInstruction(const NT_MODULE *module, const size_t pc, uint8_t *opcode,
+                              uint64_t *operand)
+{
+    *opcode = ntRead(module, pc);
+    *operand = 0;
+    if (!hasOperand(*opcode))
+        return 1;
+
+    size_t length = ntReadVariant(module, pc + 1, operand);
+    assert(length);
+    if (*opcode == BC_TAIL_CALL)
+    {
+        // the frame size follows the callee
+        uint64_t frameSize;
+        const size_t frameLength = ntReadVariant(module, pc + 1 + length, &frameSize);
+        assert(frameLength);
+        length += frameLength;
+    }
+    return 1 + length;
+}
+
+// Branches keep the compact pc of their target in value64 until the stream is final.
+static void decodeInstruction(const NT_MODULE *module, const NT_ASSEMBLY *assembly,
+                              const size_t pc, NT_INSTRUCTION *instruction)
+{
+    uint8_t opcode;
+    uint64_t operand;
+    readInstruction(module, pc, &opcode, &operand);
+
+    instruction->opcode = opcode;
+    instruction->operand = 0;
+    instruction->value64 = 0;
+
+    switch (opcode)
+    {
+    case BC_ONE_32:
+        instruction->value32 = 1;
+        break;
+    case BC_CONST_32: {
+        const size_t size = ntArrayGetU32(&module->constants, operand, &instruction->value32);
+        assert(size);
+        break;
+    }
+    case BC_CONST_64: {
+        const size_t size = ntArrayGetU64(&module->constants, operand, &instruction->value64);
+        assert(size);
+        break;
+    }
+    case BC_CONST_OBJECT:
+        instruction->object = ntGetConstantObject(assembly, operand);
+        assert(instruction->object);
+        assert(IS_VALID_OBJECT(instruction->object));
+        break;
+    case BC_CALL_DIRECT:
+        instruction->object = ntGetConstantObject(assembly, operand);
+        assert(instruction->object);
+        assert(instruction->object->type->objectType == NT_OBJECT_DELEGATE);
+        break;
+    case BC_TAIL_CALL: {
+        instruction->object = ntGetConstantObject(assembly, operand);
+        assert(instruction->object);
+        assert(instruction->object->type->objectType == NT_OBJECT_DELEGATE);
+
+        // the frame size follows the callee, counted in 32-bit slots like POP
+        uint64_t callee;
+        uint64_t frameSize;
+        const size_t calleeLength = ntReadVariant(module, pc + 1, &callee);
+        const size_t length = ntReadVariant(module, pc + 1 + calleeLength, &frameSize);
+        assert(length);
+        assert(frameSize * sizeof(uint32_t) <= UINT32_MAX);
+        instruction->operand = (uint32_t)(frameSize * sizeof(uint32_t));
+        break;
+    }
+    case BC_BRANCH:
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_32:
+    case BC_BRANCH_NZ_64:
+        // branch offsets are relative to the branch opcode, dead code may jump to the very end
+        instruction->value64 = pc + (int64_t)operand;
+        assert(instruction->value64 <= module->code.count);
+        break;
+    case BC_POP:
+        // POP counts 32-bit slots, the interpreter wants bytes
+        assert(operand * sizeof(uint32_t) <= UINT32_MAX);
+        instruction->operand = (uint32_t)(operand * sizeof(uint32_t));
+        break;
+    case BC_LOAD_SP_32:
+    case BC_LOAD_SP_64:
+    case BC_STORE_SP_32:
+    case BC_STORE_SP_64:
+        assert(operand <= UINT32_MAX);
+        instruction->operand = (uint32_t)operand;
+        break;
+    default:
+        break;
+    }
+}
+
+// Rewrites the hottest codegen sequences into superinstructions, in place. Only the first
+// instruction of a sequence may be a branch target. remap receives the new index of every old
+// instruction.
+static size_t fuseInstructions(NT_INSTRUCTION *instructions, size_t *pcs, const bool *targets,
+                               const size_t count, size_t *remap)
+{
+    size_t write = 0;
+    size_t read = 0;
+    while (read < count)
+    {
+        const NT_INSTRUCTION *const current = &instructions[read];
+        const NT_INSTRUCTION *next = NULL;
+        const NT_INSTRUCTION *third = NULL;
+        if (read + 1 < count && !targets[read + 1])
+        {
+            next = &instructions[read + 1];
+            if (read + 2 < count && !targets[read + 2])
+                third = &instructions[read + 2];
+        }
+
+        NT_INSTRUCTION fused = *current;
+        size_t length = 1;
+
+        switch (current->opcode)
+        {
+        case BC_LOAD_SP_32:
+            if (third && (third->opcode == BC_ADD_I32 || third->opcode == BC_SUB_I32))
+            {
+                const bool add = third->opcode == BC_ADD_I32;
+                if (next->opcode == BC_LOAD_SP_32 &&
+                    (next->operand == 0 || next->operand >= sizeof(uint32_t)))
+                {
+                    // the second load sees the stack one slot higher than the first
+                    fused.opcode = add ? BC_ADD_SP_SP_I32 : BC_SUB_SP_SP_I32;
+                    fused.value64 = 0;
+                    fused.value32 = next->operand == 0 ? current->operand
+                                                       : next->operand - sizeof(uint32_t);
+                    length = 3;
+                }
+                else if (isConst32(next->opcode))
+                {
+                    fused.opcode = add ? BC_ADD_SP_CONST_I32 : BC_SUB_SP_CONST_I32;
+                    fused.value64 = next->value64;
+                    length = 3;
+                }
+            }
+            break;
+        case BC_STORE_SP_32:
+        case BC_STORE_SP_64:
+            if (third && next->opcode == BC_POP && third->opcode == BC_RETURN)
+            {
+                fused.opcode = current->opcode == BC_STORE_SP_32 ? BC_RETURN_32 : BC_RETURN_64;
+                fused.value64 = 0;
+                fused.value32 = next->operand;
+                length = 3;
+            }
+            break;
+        case BC_POP:
+            if (next && next->opcode == BC_RETURN)
+            {
+                fused.opcode = BC_POP_RETURN;
+                length = 2;
+            }
+            break;
+        case BC_CONST_OBJECT:
+            // a constant delegate called right away is a direct call too
+            if (next && next->opcode == BC_CALL)
+            {
+                fused.opcode = BC_CALL_DIRECT;
+                length = 2;
+            }
+            break;
+        default:
+            if (next && next->opcode == BC_BRANCH_Z_32 && compareBranch(current->opcode) != BC_LAST)
+            {
+                fused.opcode = compareBranch(current->opcode);
+                fused.value64 = next->value64;
+                length = 2;
+            }
+            break;
+        }
+
+        for (size_t i = 0; i < length; ++i)
+            remap[read + i] = write;
+        pcs[write] = pcs[read];
+        instructions[write++] = fused;
+        read += length;
+    }
+    remap[count] = write;
+    return write;
+}
+
+// growable output of the lowering passes
+typedef struct
+{
+    NT_INSTRUCTION *instructions;
+    size_t *pcs;
+    size_t count;
+    size_t capacity;
+} STREAM;
+
+static size_t streamAdd(STREAM *stream, const NT_INSTRUCTION *instruction, const size_t pc)
+{
+    if (stream->count == stream->capacity)
+    {
+        stream->capacity = stream->capacity < 64 ? 64 : stream->capacity * 2;
+        stream->instructions = (NT_INSTRUCTION *)ntRealloc(
+            stream->instructions, sizeof(NT_INSTRUCTION) * stream->capacity);
+        stream->pcs = (size_t *)ntRealloc(stream->pcs, sizeof(size_t) * stream->capacity);
+    }
+    stream->instructions[stream->count] = *instruction;
+    stream->pcs[stream->count] = pc;
+    return stream->count++;
+}
+
+bool ntStackEffect(const uint32_t opcode, size_t *pops, size_t *pushes)
+{
+    const size_t s32 = sizeof(uint32_t);
+    const size_t s64 = sizeof(uint64_t);
+    const size_t ref = sizeof(NT_REF);
+
+    switch (opcode)
+    {
+    case BC_ZERO_32:
+    case BC_ZERO_F32:
+    case BC_ONE_32:
+    case BC_ONE_F32:
+    case BC_CONST_32:
+    case BC_LOAD_SP_32:
+        *pops = 0;
+        *pushes = s32;
+        return true;
+    case BC_ZERO_64:
+    case BC_ZERO_F64:
+    case BC_ONE_64:
+    case BC_ONE_F64:
+    case BC_CONST_64:
+    case BC_LOAD_SP_64:
+        *pops = 0;
+        *pushes = s64;
+        return true;
+    case BC_CONST_OBJECT:
+        *pops = 0;
+        *pushes = ref;
+        return true;
+    case BC_BRANCH:
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_NZ_32:
+    case BC_STORE_SP_32:
+        *pops = 0;
+        *pushes = 0;
+        return true;
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_64:
+    case BC_STORE_SP_64:
+        *pops = 0;
+        *pushes = 0;
+        return true;
+    case BC_POP_32:
+        *pops = s32;
+        *pushes = 0;
+        return true;
+    case BC_POP_64:
+        *pops = s64;
+        *pushes = 0;
+        return true;
+    case BC_EQ_32:
+    case BC_EQ_F32:
+    case BC_NE_32:
+    case BC_NE_F32:
+    case BC_GT_I32:
+    case BC_GT_U32:
+    case BC_GT_F32:
+    case BC_LT_I32:
+    case BC_LT_U32:
+    case BC_LT_F32:
+    case BC_GE_I32:
+    case BC_GE_U32:
+    case BC_GE_F32:
+    case BC_LE_I32:
+    case BC_LE_U32:
+    case BC_LE_F32:
+    case BC_ADD_I32:
+    case BC_ADD_F32:
+    case BC_SUB_I32:
+    case BC_SUB_F32:
+    case BC_MUL_I32:
+    case BC_MUL_F32:
+    case BC_DIV_U32:
+    case BC_DIV_I32:
+    case BC_DIV_F32:
+    case BC_REM_I32:
+    case BC_REM_U32:
+    case BC_REM_F32:
+    case BC_MIN_F32:
+    case BC_MAX_F32:
+    case BC_COPYSIGN_F32:
+    case BC_AND_I32:
+    case BC_OR_I32:
+    case BC_XOR_I32:
+    case BC_SHL_I32:
+    case BC_SHR_I32:
+    case BC_SHR_U32:
+    case BC_ROL_I32:
+    case BC_ROR_I32:
+        *pops = 2 * s32;
+        *pushes = s32;
+        return true;
+    case BC_EQ_64:
+    case BC_EQ_F64:
+    case BC_NE_64:
+    case BC_NE_F64:
+    case BC_GT_I64:
+    case BC_GT_U64:
+    case BC_GT_F64:
+    case BC_LT_I64:
+    case BC_LT_U64:
+    case BC_LT_F64:
+    case BC_GE_I64:
+    case BC_GE_U64:
+    case BC_GE_F64:
+    case BC_LE_I64:
+    case BC_LE_U64:
+    case BC_LE_F64:
+        *pops = 2 * s64;
+        *pushes = s32;
+        return true;
+    case BC_ADD_I64:
+    case BC_ADD_F64:
+    case BC_SUB_I64:
+    case BC_SUB_F64:
+    case BC_MUL_I64:
+    case BC_MUL_F64:
+    case BC_DIV_U64:
+    case BC_DIV_I64:
+    case BC_DIV_F64:
+    case BC_REM_I64:
+    case BC_REM_U64:
+    case BC_REM_F64:
+    case BC_MIN_F64:
+    case BC_MAX_F64:
+    case BC_COPYSIGN_F64:
+    case BC_AND_I64:
+    case BC_OR_I64:
+    case BC_XOR_I64:
+    case BC_SHL_I64:
+    case BC_SHR_I64:
+    case BC_SHR_U64:
+    case BC_ROL_I64:
+    case BC_ROR_I64:
+        *pops = 2 * s64;
+        *pushes = s64;
+        return true;
+    case BC_CONCAT:
+        *pops = 2 * ref;
+        *pushes = ref;
+        return true;
+    case BC_NEG_I32:
+    case BC_NEG_F32:
+    case BC_NOT_32:
+    case BC_IS_ZERO_32:
+    case BC_IS_NOT_ZERO_32:
+    case BC_IS_ZERO_F32:
+    case BC_IS_NOT_ZERO_F32:
+    case BC_CONVERT_F32_I32:
+    case BC_CONVERT_F32_U32:
+    case BC_TRUNCATE_I32_F32:
+    case BC_TRUNCATE_U32_F32:
+    case BC_NEAREST_F32:
+    case BC_CEIL_F32:
+    case BC_FLOOR_F32:
+    case BC_TRUNCATE_F32:
+    case BC_ABS_F32:
+    case BC_SQRT_F32:
+    case BC_CLZ_I32:
+    case BC_CTZ_I32:
+    case BC_POPCNT_I32:
+        *pops = s32;
+        *pushes = s32;
+        return true;
+    case BC_NEG_I64:
+    case BC_NEG_F64:
+    case BC_NOT_64:
+    case BC_CONVERT_F64_I64:
+    case BC_CONVERT_F64_U64:
+    case BC_TRUNCATE_I64_F64:
+    case BC_TRUNCATE_U64_F64:
+    case BC_NEAREST_F64:
+    case BC_CEIL_F64:
+    case BC_FLOOR_F64:
+    case BC_TRUNCATE_F64:
+    case BC_ABS_F64:
+    case BC_SQRT_F64:
+    case BC_CLZ_I64:
+    case BC_CTZ_I64:
+    case BC_POPCNT_I64:
+        *pops = s64;
+        *pushes = s64;
+        return true;
+    case BC_IS_ZERO_64:
+    case BC_IS_NOT_ZERO_64:
+    case BC_IS_ZERO_F64:
+    case BC_IS_NOT_ZERO_F64:
+    case BC_WRAP_I64:
+    case BC_DEMOTE_F64:
+    case BC_CONVERT_F32_I64:
+    case BC_CONVERT_F32_U64:
+    case BC_TRUNCATE_I32_F64:
+    case BC_TRUNCATE_U32_F64:
+        *pops = s64;
+        *pushes = s32;
+        return true;
+    case BC_EXTEND_I32:
+    case BC_EXTEND_U32:
+    case BC_PROMOTE_F32:
+    case BC_CONVERT_F64_I32:
+    case BC_CONVERT_F64_U32:
+    case BC_TRUNCATE_I64_F32:
+    case BC_TRUNCATE_U64_F32:
+        *pops = s32;
+        *pushes = s64;
+        return true;
+    case BC_CONVERT_I32_STR:
+    case BC_CONVERT_U32_STR:
+    case BC_CONVERT_F32_STR:
+        *pops = ref;
+        *pushes = s32;
+        return true;
+    case BC_CONVERT_I64_STR:
+    case BC_CONVERT_U64_STR:
+    case BC_CONVERT_F64_STR:
+        *pops = ref;
+        *pushes = s64;
+        return true;
+    case BC_CONVERT_STR_I32:
+    case BC_CONVERT_STR_U32:
+    case BC_CONVERT_STR_F32:
+        *pops = s32;
+        *pushes = ref;
+        return true;
+    case BC_CONVERT_STR_I64:
+    case BC_CONVERT_STR_U64:
+    case BC_CONVERT_STR_F64:
+        *pops = s64;
+        *pushes = ref;
+        return true;
+    default:
+        return false;
+    }
+}
+
+#ifdef NT_REGISTER_TIER
+// Stack code of a function is interpreted over abstract slots: pushes of constants and locals
+// stay pending in the slot they would occupy, and arithmetic reads its operands straight from
+// the frame. Pending slots are written back before anything that looks at the stack as memory
+// (calls, branches, other instructions), so both forms agree at every boundary.
+typedef enum
+{
+    SLOT_MEMORY,
+    SLOT_REGISTER,
+    SLOT_CONSTANT,
+} SLOT_KIND;
+
+typedef struct
+{
+    SLOT_KIND kind;
+    // source slot for SLOT_REGISTER, value for SLOT_CONSTANT
+    uint32_t value;
+} SLOT;
+
+typedef struct
+{
+    bool constant;
+    uint32_t value;
+} OPERAND;
+
+typedef struct
+{
+    STREAM *output;
+    const NT_INSTRUCTION *input;
+    const size_t *pcs;
+    const size_t *indices;
+    const bool *targets;
+    int64_t *depths;
+    size_t begin;
+    size_t end;
+
+    SLOT *slots;
+    size_t slotCount;
+    size_t depth;
+    size_t emitted;
+    bool reachable;
+    size_t pc;
+
+    // output index of the register instruction that computed the top slot
+    size_t lastWrite;
+    size_t lastWriteBase;
+    // last emitted instruction when it is a register one, its delta can absorb a stack move
+    size_t lastRegister;
+    size_t lastRegisterBase;
+} REGGEN;
+
+typedef struct
+{
+    uint16_t opcode;
+    uint16_t reg;
+    uint16_t regConstant;
+    // opcode computing the same with the operands exchanged, BC_LAST if none
+    uint16_t swapped;
+} REGISTER_OP;
+
+static const REGISTER_OP REGISTER_OPS[] = {
+    {BC_ADD_I32, BC_REG_ADD_I32, BC_REG_ADD_I32_K, BC_ADD_I32},
+    {BC_SUB_I32, BC_REG_SUB_I32, BC_REG_SUB_I32_K, BC_LAST},
+    {BC_MUL_I32, BC_REG_MUL_I32, BC_REG_MUL_I32_K, BC_MUL_I32},
+    {BC_EQ_32, BC_REG_EQ_32, BC_REG_EQ_32_K, BC_EQ_32},
+    {BC_NE_32, BC_REG_NE_32, BC_REG_NE_32_K, BC_NE_32},
+    {BC_GT_I32, BC_REG_GT_I32, BC_REG_GT_I32_K, BC_LT_I32},
+    {BC_GT_U32, BC_REG_GT_U32, BC_REG_GT_U32_K, BC_LT_U32},
+    {BC_LT_I32, BC_REG_LT_I32, BC_REG_LT_I32_K, BC_GT_I32},
+    {BC_LT_U32, BC_REG_LT_U32, BC_REG_LT_U32_K, BC_GT_U32},
+    {BC_GE_I32, BC_REG_GE_I32, BC_REG_GE_I32_K, BC_LE_I32},
+    {BC_GE_U32, BC_REG_GE_U32, BC_REG_GE_U32_K, BC_LE_U32},
+    {BC_LE_I32, BC_REG_LE_I32, BC_REG_LE_I32_K, BC_GE_I32},
+    {BC_LE_U32, BC_REG_LE_U32, BC_REG_LE_U32_K, BC_GE_U32},
+};
+
+static const REGISTER_OP *findRegisterOp(const uint32_t opcode)
+{
+    for (size_t i = 0; i < sizeof(REGISTER_OPS) / sizeof(REGISTER_OP); ++i)
+    {
+        if (REGISTER_OPS[i].opcode == opcode)
+            return &REGISTER_OPS[i];
+    }
+    return NULL;
+}
+
+static SLOT *slotAt(REGGEN *gen, const size_t offset)
+{
+    assert(offset % sizeof(uint32_t) == 0);
+    const size_t index = offset / sizeof(uint32_t);
+    if (index >= gen->slotCount)
+    {
+        const size_t count = index * 2 + 8;
+        gen->slots = (SLOT *)ntRealloc(gen->slots, sizeof(SLOT) * count);
+        for (size_t i = gen->slotCount; i < count; ++i)
+            gen->slots[i] = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+        gen->slotCount = count;
+    }
+    return &gen->slots[index];
+}
+
+static void resetSlots(REGGEN *gen)
+{
+    for (size_t i = 0; i < gen->slotCount; ++i)
+        gen->slots[i] = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+}
+
+static int32_t relative(const REGGEN *gen, const size_t offset)
+{
+    return (int32_t)((int64_t)offset - (int64_t)gen->emitted);
+}
+
+static OPERAND operandOf(REGGEN *gen, const size_t offset)
+{
+    const SLOT *slot = slotAt(gen, offset);
+    switch (slot->kind)
+    {
+    case SLOT_REGISTER:
+        return (OPERAND){.constant = false, .value = slot->value};
+    case SLOT_CONSTANT:
+        return (OPERAND){.constant = true, .value = slot->value};
+    default:
+        return (OPERAND){.constant = false, .value = (uint32_t)offset};
+    }
+}
+
+static bool emitCopy(REGGEN *gen, const NT_INSTRUCTION *instruction)
+{
+    streamAdd(gen->output, instruction, gen->pc);
+    gen->lastWrite = SIZE_MAX;
+    gen->lastRegister = SIZE_MAX;
+    return true;
+}
+
+// Emits a register instruction that leaves the runtime stack top at depthAfter.
+static bool emitRegister(REGGEN *gen, const uint16_t opcode, const size_t dst, const OPERAND left,
+                         const OPERAND right, const size_t depthAfter)
+{
+    const int64_t delta = (int64_t)depthAfter - (int64_t)gen->emitted;
+    if (delta < INT16_MIN || delta > INT16_MAX)
+        return false;
+
+    NT_INSTRUCTION instruction = {
+        .opcode = opcode,
+        .delta = (int16_t)delta,
+    };
+    instruction.dst = relative(gen, dst);
+    instruction.left = left.constant ? (int32_t)left.value : relative(gen, left.value);
+    instruction.right = right.constant ? (int32_t)right.value : relative(gen, right.value);
+
+    gen->lastWriteBase = gen->emitted;
+    gen->lastWrite = streamAdd(gen->output, &instruction, gen->pc);
+    gen->lastRegister = gen->lastWrite;
+    gen->lastRegisterBase = gen->emitted;
+    gen->emitted = depthAfter;
+    return true;
+}
+
+static bool materialize(REGGEN *gen, const size_t offset)
+{
+    SLOT *slot = slotAt(gen, offset);
+    if (slot->kind == SLOT_MEMORY)
+        return true;
+
+    const OPERAND source = operandOf(gen, offset);
+    const OPERAND none = {.constant = true, .value = 0};
+    slot->kind = SLOT_MEMORY;
+    if (source.constant)
+        return emitRegister(gen, BC_REG_MOVE_32_K, offset, none, source, gen->depth);
+    return emitRegister(gen, BC_REG_MOVE_32, offset, source, none, gen->depth);
+}
+
+// Writes every pending slot back and moves the runtime stack top to the abstract depth.
+static bool flush(REGGEN *gen)
+{
+    for (size_t offset = 0; offset < gen->depth; offset += sizeof(uint32_t))
+    {
+        if (!materialize(gen, offset))
+            return false;
+    }
+
+    const int64_t delta = (int64_t)gen->depth - (int64_t)gen->lastRegisterBase;
+    if (gen->emitted != gen->depth && gen->lastRegister == gen->output->count - 1 &&
+        delta >= INT16_MIN && delta <= INT16_MAX)
+    {
+        gen->output->instructions[gen->lastRegister].delta = (int16_t)delta;
+    }
+    else if (gen->emitted > gen->depth)
+    {
+        const NT_INSTRUCTION pop = {
+            .opcode = BC_POP,
+            .operand = (uint32_t)(gen->emitted - gen->depth),
+        };
+        emitCopy(gen, &pop);
+    }
+    else if (gen->emitted < gen->depth)
+    {
+        const OPERAND none = {.constant = true, .value = 0};
+        if (!emitRegister(gen, BC_REG_ADJUST, 0, none, none, gen->depth))
+            return false;
+    }
+    gen->emitted = gen->depth;
+    gen->lastWrite = SIZE_MAX;
+    return true;
+}
+
+static bool pushSlot(REGGEN *gen, const SLOT slot)
+{
+    *slotAt(gen, gen->depth) = slot;
+    gen->depth += sizeof(uint32_t);
+    gen->lastWrite = SIZE_MAX;
+    return true;
+}
+
+static bool popSlots(REGGEN *gen, const size_t size)
+{
+    if (size > gen->depth || size % sizeof(uint32_t) != 0)
+        return false;
+
+    for (size_t offset = gen->depth - size; offset < gen->depth; offset += sizeof(uint32_t))
+        *slotAt(gen, offset) = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+    gen->depth -= size;
+    gen->lastWrite = SIZE_MAX;
+    return true;
+}
+
+static bool branchTo(REGGEN *gen, const NT_INSTRUCTION *instruction)
+{
+    const size_t target = gen->indices[instruction->value64];
+    if (target < gen->begin || target >= gen->end)
+        return false;
+
+    if (gen->depths[target] == -1)
+        gen->depths[target] = (int64_t)gen->depth;
+    return gen->depths[target] == (int64_t)gen->depth;
+}
+
+static bool registerBinary(REGGEN *gen, const REGISTER_OP *op)
+{
+    if (gen->depth < 2 * sizeof(uint32_t))
+        return false;
+
+    const size_t dst = gen->depth - 2 * sizeof(uint32_t);
+    OPERAND left = operandOf(gen, dst);
+    OPERAND right = operandOf(gen, gen->depth - sizeof(uint32_t));
+
+    if (left.constant && !right.constant && op->swapped != BC_LAST)
+    {
+        const OPERAND tmp = left;
+        left = right;
+        right = tmp;
+        op = findRegisterOp(op->swapped);
+        assert(op);
+    }
+    else if (left.constant)
+    {
+        if (!materialize(gen, dst))
+            return false;
+        left = operandOf(gen, dst);
+    }
+
+    const size_t depthAfter = gen->depth - sizeof(uint32_t);
+    if (!emitRegister(gen, right.constant ? op->regConstant : op->reg, dst, left, right,
+                      depthAfter))
+        return false;
+
+    const size_t lastWrite = gen->lastWrite;
+    const size_t lastWriteBase = gen->lastWriteBase;
+    popSlots(gen, 2 * sizeof(uint32_t));
+    pushSlot(gen, (SLOT){.kind = SLOT_MEMORY, .value = 0});
+    gen->lastWrite = lastWrite;
+    gen->lastWriteBase = lastWriteBase;
+    return true;
+}
+
+static bool registerStore(REGGEN *gen, const size_t offset)
+{
+    if (offset + sizeof(uint32_t) > gen->depth)
+        return false;
+
+    const size_t top = gen->depth - sizeof(uint32_t);
+    const size_t dst = top - offset;
+    if (dst == top)
+        return true;
+
+    // pending copies of the old value must be taken before it changes
+    bool referenced = false;
+    for (size_t slot = dst + sizeof(uint32_t); slot < gen->depth; slot += sizeof(uint32_t))
+    {
+        const SLOT *current = slotAt(gen, slot);
+        if (current->kind == SLOT_REGISTER && current->value == dst)
+        {
+            referenced = true;
+            if (!materialize(gen, slot))
+                return false;
+        }
+    }
+
+    const OPERAND value = operandOf(gen, top);
+    if (!referenced && gen->lastWrite != SIZE_MAX && slotAt(gen, top)->kind == SLOT_MEMORY)
+    {
+        // the value was just computed into the top slot, compute it into the variable instead
+        NT_INSTRUCTION *last = &gen->output->instructions[gen->lastWrite];
+        last->dst = (int32_t)((int64_t)dst - (int64_t)gen->lastWriteBase);
+        *slotAt(gen, top) = (SLOT){.kind = SLOT_REGISTER, .value = (uint32_t)dst};
+        *slotAt(gen, dst) = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+        gen->lastWrite = SIZE_MAX;
+        return true;
+    }
+
+    *slotAt(gen, dst) = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+    gen->lastWrite = SIZE_MAX;
+    if (!value.constant && value.value == dst)
+        return true;
+
+    const OPERAND none = {.constant = true, .value = 0};
+    if (value.constant)
+        return emitRegister(gen, BC_REG_MOVE_32_K, dst, none, value, gen->depth);
+    return emitRegister(gen, BC_REG_MOVE_32, dst, value, none, gen->depth);
+}
+
+static bool registerCall(REGGEN *gen, const NT_INSTRUCTION *instruction, const size_t pops,
+                         const size_t pushes)
+{
+    if (!flush(gen) || pops > gen->depth)
+        return false;
+    emitCopy(gen, instruction);
+    gen->depth = gen->depth - pops + pushes;
+    gen->emitted = gen->depth;
+    return gen->depth % sizeof(uint32_t) == 0;
+}
+
+static bool registerInstruction(REGGEN *gen, const size_t index)
+{
+    const NT_INSTRUCTION *instruction = &gen->input[index];
+    const REGISTER_OP *op = findRegisterOp(instruction->opcode);
+    if (op)
+        return registerBinary(gen, op);
+
+    switch (instruction->opcode)
+    {
+    case BC_ZERO_32:
+    case BC_ONE_32:
+    case BC_CONST_32:
+        return pushSlot(gen, (SLOT){.kind = SLOT_CONSTANT, .value = instruction->value32});
+    case BC_LOAD_SP_32: {
+        if (instruction->operand + sizeof(uint32_t) > gen->depth)
+            return false;
+        const size_t source = gen->depth - sizeof(uint32_t) - instruction->operand;
+        const SLOT *slot = slotAt(gen, source);
+        if (slot->kind != SLOT_MEMORY)
+            return pushSlot(gen, *slot);
+        return pushSlot(gen, (SLOT){.kind = SLOT_REGISTER, .value = (uint32_t)source});
+    }
+    case BC_STORE_SP_32:
+        return registerStore(gen, instruction->operand);
+    case BC_POP:
+        return popSlots(gen, instruction->operand);
+    case BC_POP_32:
+        return popSlots(gen, sizeof(uint32_t));
+    case BC_POP_64:
+        return popSlots(gen, sizeof(uint64_t));
+    case BC_BRANCH:
+        if (!flush(gen) || !branchTo(gen, instruction))
+            return false;
+        gen->reachable = false;
+        return emitCopy(gen, instruction);
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_32:
+    case BC_BRANCH_NZ_64:
+        if (!flush(gen) || !branchTo(gen, instruction))
+            return false;
+        return emitCopy(gen, instruction);
+    case BC_RETURN:
+    case BC_TAIL_CALL:
+        if (!flush(gen))
+            return false;
+        gen->reachable = false;
+        return emitCopy(gen, instruction);
+    case BC_CALL: {
+        // only calls whose delegate is the constant pushed just before have a known effect
+        if (index == gen->begin || gen->targets[index])
+            return false;
+        const NT_INSTRUCTION *previous = &gen->input[index - 1];
+        if (previous->opcode != BC_CONST_OBJECT ||
+            previous->object->type->objectType != NT_OBJECT_DELEGATE)
+            return false;
+
+        const NT_DELEGATE *delegate = (const NT_DELEGATE *)previous->object;
+        return registerCall(gen, instruction, sizeof(NT_REF) + delegate->paramsSize,
+                            delegate->returnSize);
+    }
+    case BC_CALL_DIRECT: {
+        const NT_DELEGATE *delegate = (const NT_DELEGATE *)instruction->object;
+        return registerCall(gen, instruction, delegate->paramsSize, delegate->returnSize);
+    }
+    default: {
+        size_t pops;
+        size_t pushes;
+        if (!ntStackEffect(instruction->opcode, &pops, &pushes) || !flush(gen) ||
+            pops > gen->depth)
+            return false;
+        emitCopy(gen, instruction);
+        gen->depth = gen->depth - pops + pushes;
+        gen->emitted = gen->depth;
+        // slots above the old top were pending garbage, now they hold real values
+        for (size_t offset = gen->depth - pushes; offset < gen->depth; offset += sizeof(uint32_t))
+            *slotAt(gen, offset) = (SLOT){.kind = SLOT_MEMORY, .value = 0};
+        return gen->depth % sizeof(uint32_t) == 0;
+    }
+    }
+}
+
+static bool registerFunction(REGGEN *gen, const size_t paramsSize, size_t *remap)
+{
+    for (size_t i = gen->begin; i < gen->end; ++i)
+        gen->depths[i] = -1;
+
+    resetSlots(gen);
+    gen->depths[gen->begin] = (int64_t)paramsSize;
+    gen->depth = paramsSize;
+    gen->emitted = paramsSize;
+    gen->reachable = true;
+    gen->lastWrite = SIZE_MAX;
+    gen->lastRegister = SIZE_MAX;
+
+    for (size_t i = gen->begin; i < gen->end; ++i)
+    {
+        gen->pc = gen->pcs[i];
+        if (gen->targets[i])
+        {
+            if (gen->reachable)
+            {
+                if (!flush(gen))
+                    return false;
+                if (gen->depths[i] == -1)
+                    gen->depths[i] = (int64_t)gen->depth;
+            }
+            else if (gen->depths[i] == -1)
+                return false;
+
+            if (gen->depths[i] != (int64_t)gen->depth && gen->reachable)
+                return false;
+
+            resetSlots(gen);
+            gen->depth = (size_t)gen->depths[i];
+            gen->emitted = gen->depth;
+            gen->reachable = true;
+            gen->lastWrite = SIZE_MAX;
+            gen->lastRegister = SIZE_MAX;
+        }
+
+        remap[i] = gen->output->count;
+        if (!gen->reachable)
+            continue;
+
+        if (!registerInstruction(gen, i))
+            return false;
+    }
+
+    return !gen->reachable || flush(gen);
+}
+
+#endif
+
+static NT_DELEGATE *getModuleDelegate(const NT_MODULE *module, const size_t index)
+{
+    NT_SYMBOL_ENTRY entry;
+    const bool result = ntArrayGet(module->type.fields.table, index * sizeof(NT_SYMBOL_ENTRY),
+                                   &entry, sizeof(NT_SYMBOL_ENTRY)) == sizeof(NT_SYMBOL_ENTRY);
+    assert(result);
+
+    if ((entry.type & (SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) == 0)
+        return NULL;
+
+    NT_DELEGATE *delegate = (NT_DELEGATE *)entry.data;
+    assert(delegate);
+    assert(IS_VALID_OBJECT(delegate));
+    if (delegate->native || delegate->sourceModule != module || delegate->addr == SIZE_MAX)
+        return NULL;
+
+    assert(delegate->addr < module->code.count);
+    return delegate;
+}
+
+static void copyInstructions(STREAM *output, const NT_INSTRUCTION *input, const size_t *pcs,
+                             const size_t begin, const size_t end, size_t *remap)
+{
+    for (size_t i = begin; i < end; ++i)
+        remap[i] = streamAdd(output, &input[i], pcs[i]);
+}
+
+typedef struct
+{
+    size_t index;
+    const NT_DELEGATE *delegate;
+    size_t maxStack;
+} FUNCTION_ENTRY;
+
+// Lists the functions of the module by entry index, a function may be listed under more than
+// one symbol but appears once.
+static size_t moduleFunctions(const NT_MODULE *module, const size_t *indices,
+                              FUNCTION_ENTRY *entries)
+{
+    const size_t symbolCount = module->type.fields.table->count / sizeof(NT_SYMBOL_ENTRY);
+    size_t entryCount = 0;
+
+    for (size_t i = 0; i < symbolCount; ++i)
+    {
+        const NT_DELEGATE *delegate = getModuleDelegate(module, i);
+        if (!delegate)
+            continue;
+
+        const size_t index = indices[delegate->addr];
+        bool listed = false;
+        for (size_t j = 0; j < entryCount; ++j)
+            listed |= entries[j].index == index;
+        if (listed)
+            continue;
+
+        size_t j = entryCount;
+        while (j > 0 && entries[j - 1].index > index)
+        {
+            entries[j] = entries[j - 1];
+            --j;
+        }
+        entries[j] = (FUNCTION_ENTRY){
+            .index = index,
+            .delegate = delegate,
+            .maxStack = 0,
+        };
+        ++entryCount;
+    }
+    return entryCount;
+}
+
+static size_t functionEnd(const FUNCTION_ENTRY *entries, const size_t entryCount, const size_t i,
+                          const size_t count)
+{
+    return i + 1 < entryCount ? entries[i + 1].index : count;
+}
+
+#ifdef NT_REGISTER_TIER
+// Translates every function of the module to register instructions, functions the pass can't
+// follow keep their stack form.
+static void registerModule(const FUNCTION_ENTRY *entries, const size_t entryCount,
+                           const NT_INSTRUCTION *input, const size_t *pcs, const size_t *indices,
+                           const bool *targets, const size_t count, STREAM *output,
+                           size_t *remap)
+{
+    REGGEN gen = {
+        .output = output,
+        .input = input,
+        .pcs = pcs,
+        .indices = indices,
+        .targets = targets,
+        .depths = (int64_t *)ntMalloc(sizeof(int64_t) * (count + 1)),
+        .slots = NULL,
+        .slotCount = 0,
+    };
+
+    copyInstructions(output, input, pcs, 0, entryCount > 0 ? entries[0].index : count, remap);
+    for (size_t i = 0; i < entryCount; ++i)
+    {
+        const size_t start = output->count;
+        gen.begin = entries[i].index;
+        gen.end = functionEnd(entries, entryCount, i, count);
+        if (!registerFunction(&gen, entries[i].delegate->paramsSize, remap))
+        {
+            output->count = start;
+            copyInstructions(output, input, pcs, gen.begin, gen.end, remap);
+        }
+    }
+    remap[count] = output->count;
+
+    ntFree(gen.slots);
+    ntFree(gen.depths);
+}
+#endif
+
+bool ntTranslateModule(NT_MODULE *module, const NT_ASSEMBLY *assembly)
+{
+    assert(module);
+    assert(assembly);
+
+    if (module->instructions)
+        return true;
+
+    const size_t codeSize = module->code.count;
+    const size_t symbolCount = module->type.fields.table->count / sizeof(NT_SYMBOL_ENTRY);
+
+    // find where every instruction starts
+    size_t *indices = (size_t *)ntMalloc(sizeof(size_t) * (codeSize + 1));
+    for (size_t pc = 0; pc <= codeSize; ++pc)
+        indices[pc] = SIZE_MAX;
+
+    size_t count = 0;
+    for (size_t pc = 0; pc < codeSize;)
+    {
+        uint8_t opcode;
+        uint64_t operand;
+        indices[pc] = count++;
+        pc += readInstruction(module, pc, &opcode, &operand);
+    }
+    indices[codeSize] = count;
+
+    NT_INSTRUCTION *instructions = (NT_INSTRUCTION *)ntMalloc(sizeof(NT_INSTRUCTION) * (count + 1));
+    size_t *pcs = (size_t *)ntMalloc(sizeof(size_t) * (count + 1));
+    bool *targets = (bool *)ntMalloc(sizeof(bool) * (count + 1));
+    size_t *lowered = (size_t *)ntMalloc(sizeof(size_t) * (count + 1));
+
+    for (size_t i = 0; i <= count; ++i)
+        targets[i] = false;
+
+    for (size_t pc = 0; pc < codeSize; ++pc)
+    {
+        const size_t index = indices[pc];
+        if (index == SIZE_MAX)
+            continue;
+
+        decodeInstruction(module, assembly, pc, &instructions[index]);
+        pcs[index] = pc;
+
+        if (isBranch(instructions[index].opcode))
+        {
+            assert(indices[instructions[index].value64] != SIZE_MAX);
+            targets[indices[instructions[index].value64]] = true;
+        }
+    }
+
+    for (size_t i = 0; i < symbolCount; ++i)
+    {
+        const NT_DELEGATE *delegate = getModuleDelegate(module, i);
+        if (delegate)
+        {
+            assert(indices[delegate->addr] != SIZE_MAX);
+            targets[indices[delegate->addr]] = true;
+        }
+    }
+
+    FUNCTION_ENTRY *entries = (FUNCTION_ENTRY *)ntMalloc(sizeof(FUNCTION_ENTRY) * symbolCount);
+    const size_t entryCount = moduleFunctions(module, indices, entries);
+    for (size_t i = 0; i < entryCount; ++i)
+    {
+        if (!ntVerifyFunction(entries[i].delegate, instructions, indices, entries[i].index,
+                              functionEnd(entries, entryCount, i, count), &entries[i].maxStack))
+        {
+            const NT_STRING *name = entries[i].delegate->name;
+            char *chars = ntToCharFixed(name->chars, name->length);
+            printf("Function '%s' failed bytecode verification.\n", chars);
+            ntFree(chars);
+
+            ntFree(entries);
+            ntFree(lowered);
+            ntFree(targets);
+            ntFree(pcs);
+            ntFree(instructions);
+            ntFree(indices);
+            return false;
+        }
+    }
+
+    STREAM output = {
+        .instructions = NULL,
+        .pcs = NULL,
+        .count = 0,
+        .capacity = 0,
+    };
+#ifdef NT_REGISTER_TIER
+    registerModule(entries, entryCount, instructions, pcs, indices, targets, count, &output,
+                   lowered);
+#else
+    copyInstructions(&output, instructions, pcs, 0, count, lowered);
+    lowered[count] = output.count;
+#endif
+
+    // branch targets of the lowered code
+    bool *outputTargets = (bool *)ntMalloc(sizeof(bool) * (output.count + 1));
+    size_t *remap = (size_t *)ntMalloc(sizeof(size_t) * (output.count + 1));
+    for (size_t i = 0; i <= output.count; ++i)
+        outputTargets[i] = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (targets[i])
+            outputTargets[lowered[i]] = true;
+    }
+
+    output.count = fuseInstructions(output.instructions, output.pcs, outputTargets, output.count,
+                                    remap);
+
+    // sentinel for branches to the end of the code, stops instead of running off the array
+    const NT_INSTRUCTION halt = {.opcode = BC_HALT};
+    streamAdd(&output, &halt, codeSize);
+    --output.count;
+
+    for (size_t i = 0; i < output.count; ++i)
+    {
+        NT_INSTRUCTION *instruction = &output.instructions[i];
+        if (isBranch(instruction->opcode))
+            instruction->target =
+                output.instructions + remap[lowered[indices[instruction->value64]]];
+    }
+
+    for (size_t i = 0; i < symbolCount; ++i)
+    {
+        NT_DELEGATE *delegate = getModuleDelegate(module, i);
+        if (!delegate)
+            continue;
+
+        const size_t index = indices[delegate->addr];
+        delegate->entry = output.instructions + remap[lowered[index]];
+        for (size_t j = 0; j < entryCount; ++j)
+        {
+            if (entries[j].index == index)
+                delegate->maxStack = entries[j].maxStack;
+        }
+    }
+
+    module->instructions = output.instructions;
+    module->instructionPcs = output.pcs;
+    module->instructionCount = output.count;
+
+    ntFree(remap);
+    ntFree(outputTargets);
+    ntFree(entries);
+    ntFree(lowered);
+    ntFree(targets);
+    ntFree(pcs);
+    ntFree(instructions);
+    ntFree(indices);
+    return true;
+}
+
+bool ntTranslateAssembly(NT_ASSEMBLY *assembly)
+{
+    assert(assembly);
+
+    for (size_t i = 0; i < assembly->objects->count / sizeof(NT_REF); ++i)
+    {
+        NT_OBJECT *object = NULL;
+        const bool result = ntArrayGet(assembly->objects, i * sizeof(NT_REF), &object,
+                                       sizeof(NT_REF)) == sizeof(NT_REF);
+        assert(result);
+        assert(object);
+        assert(IS_VALID_OBJECT(object));
+
+        if (object->type->objectType != NT_OBJECT_TYPE_TYPE ||
+            ((NT_TYPE *)object)->objectType != NT_OBJECT_MODULE)
+            continue;
+
+        if (!ntTranslateModule((NT_MODULE *)object, assembly))
+            return false;
+    }
+    return true;
+}
+
+void ntFreezeModule(NT_MODULE *module)
+{
+    assert(module->instructions);
+#ifdef NT_JIT
+    const size_t symbolCount = module->type.fields.table->count / sizeof(NT_SYMBOL_ENTRY);
+    for (size_t i = 0; i < symbolCount; ++i)
+    {
+        NT_DELEGATE *delegate = getModuleDelegate(module, i);
+        if (!delegate || delegate->calls >= NT_JIT_THRESHOLD)
+            continue;
+
+        // saturated, so calls never count again
+        delegate->calls = NT_JIT_THRESHOLD;
+        ntJitCompile(delegate);
+    }
+
+    // loops record no traces, the operand of BRANCH counts them
+    for (size_t i = 0; i < module->instructionCount; ++i)
+    {
+        NT_INSTRUCTION *instruction = &module->instructions[i];
+        if (instruction->opcode == BC_BRANCH && instruction->target < instruction)
+            instruction->operand = UINT32_MAX;
+    }
+#else
+    (void)module;
+#endif
+}
+
+size_t ntInstructionPc(const NT_MODULE *module, const NT_INSTRUCTION *instruction)
+{
+    assert(module->instructions);
+    assert(instruction >= module->instructions &&
+           instruction <= module->instructions + module->instructionCount);
+    return module->instructionPcs[instruction - module->instructions];
+}
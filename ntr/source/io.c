@@ -0,0 +1,516 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/io.h>
+#include <netuno/memory.h>
+#include <netuno/native.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+
+#ifdef __linux__
+#define NT_EVENT_LOOP
+#include <errno.h>
+#include <sys/epoll.h>
+#include <time.h>
+#endif
+
+#ifndef _WIN32
+#define NT_POSIX_IO
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// descriptors reported by one epoll_wait
+#define EVENT_BATCH 64
+
+static NT_MODULE IO_MODULE = {
+    .type.object =
+        {
+            .type = NULL,
+        },
+};
+
+#ifdef NT_EVENT_LOOP
+typedef struct
+{
+    // NULL while the caller runs the loop itself
+    NT_FIBER *fiber;
+    NT_ASSEMBLY *assembly;
+    int fd;
+    NT_IO_COMPLETE complete;
+    uint64_t data;
+    bool ready;
+    uint32_t result;
+} WAITER;
+
+typedef struct
+{
+    uint64_t deadline;
+    WAITER *waiter;
+} TIMER;
+
+typedef struct
+{
+    int epoll;
+    // binary heap on the deadline
+    NT_ARRAY timers;
+    size_t waiting;
+} LOOP;
+
+// every thread runs the fibers it parked
+static _Thread_local LOOP *threadLoop = NULL;
+
+static LOOP *currentLoop(void)
+{
+    if (threadLoop)
+        return threadLoop;
+
+    const int epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0)
+        return NULL;
+
+    threadLoop = (LOOP *)ntMalloc(sizeof(LOOP));
+    threadLoop->epoll = epoll;
+    ntInitArray(&threadLoop->timers);
+    threadLoop->waiting = 0;
+    return threadLoop;
+}
+
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000 + (uint64_t)time.tv_nsec / 1000000;
+}
+
+static size_t timerCount(const LOOP *loop)
+{
+    return loop->timers.count / sizeof(TIMER);
+}
+
+static void pushTimer(LOOP *loop, const TIMER timer)
+{
+    ntArrayAdd(&loop->timers, &timer, sizeof(TIMER));
+    TIMER *timers = (TIMER *)loop->timers.data;
+    for (size_t i = timerCount(loop) - 1; i > 0 && timers[(i - 1) / 2].deadline > timers[i].deadline;
+         i = (i - 1) / 2)
+    {
+        const TIMER swap = timers[i];
+        timers[i] = timers[(i - 1) / 2];
+        timers[(i - 1) / 2] = swap;
+    }
+}
+
+static TIMER popTimer(LOOP *loop)
+{
+    TIMER *timers = (TIMER *)loop->timers.data;
+    const TIMER first = timers[0];
+    loop->timers.count -= sizeof(TIMER);
+    const size_t count = timerCount(loop);
+    timers[0] = timers[count];
+
+    for (size_t i = 0;;)
+    {
+        size_t least = i;
+        const size_t left = i * 2 + 1;
+        if (left < count && timers[left].deadline < timers[least].deadline)
+            least = left;
+        if (left + 1 < count && timers[left + 1].deadline < timers[least].deadline)
+            least = left + 1;
+        if (least == i)
+            break;
+
+        const TIMER swap = timers[i];
+        timers[i] = timers[least];
+        timers[least] = swap;
+        i = least;
+    }
+    return first;
+}
+
+static WAITER *createWaiter(const NT_VM *vm, const int fd, const NT_IO_COMPLETE complete,
+                            const uint64_t data)
+{
+    WAITER *waiter = (WAITER *)ntMalloc(sizeof(WAITER));
+    waiter->fiber = vm->fiber;
+    waiter->assembly = vm->assembly;
+    waiter->fd = fd;
+    waiter->complete = complete;
+    waiter->data = data;
+    waiter->ready = false;
+    waiter->result = 0;
+    return waiter;
+}
+
+// resumes a parked fiber on the VM running the loop, which may run another assembly
+static void wake(NT_VM *vm, WAITER *waiter)
+{
+    waiter->ready = true;
+    if (!waiter->fiber)
+        return;
+
+    NT_FIBER *fiber = waiter->fiber;
+    fiber->parked = false;
+    NT_ASSEMBLY *assembly = vm->assembly;
+    vm->assembly = waiter->assembly;
+    uint32_t value;
+    // what the fiber yields next has no one to go to
+    if (ntResume(vm, fiber, waiter->result))
+        ntPop32(vm, &value);
+    vm->assembly = assembly;
+    ntFree(waiter);
+}
+
+// waits for the next descriptor or timer and wakes everything that is ready
+static bool step(NT_VM *vm, LOOP *loop)
+{
+    int timeout = -1;
+    if (timerCount(loop) > 0)
+    {
+        const uint64_t deadline = ((const TIMER *)loop->timers.data)[0].deadline;
+        const uint64_t time = now();
+        timeout = deadline > time ? (int)(deadline - time) : 0;
+    }
+
+    struct epoll_event events[EVENT_BATCH];
+    const int count = epoll_wait(loop->epoll, events, EVENT_BATCH, timeout);
+    if (count < 0 && errno != EINTR)
+        return false;
+
+    // the descriptors are one-shot, so a loop run by a woken fiber never reports them again
+    for (int i = 0; i < count; ++i)
+    {
+        WAITER *waiter = (WAITER *)events[i].data.ptr;
+        epoll_ctl(loop->epoll, EPOLL_CTL_DEL, waiter->fd, NULL);
+        loop->waiting--;
+        waiter->result = waiter->complete
+                             ? waiter->complete(waiter->fd, events[i].events, waiter->data)
+                             : events[i].events;
+        wake(vm, waiter);
+    }
+
+    const uint64_t time = now();
+    while (timerCount(loop) > 0 && ((const TIMER *)loop->timers.data)[0].deadline <= time)
+        wake(vm, popTimer(loop).waiter);
+    return true;
+}
+
+// parks the fiber that created the waiter, or runs the loop until the waiter is ready
+static bool park(NT_VM *vm, LOOP *loop, WAITER *waiter)
+{
+    if (waiter->fiber && ntYield(vm, 0))
+    {
+        waiter->fiber->parked = true;
+        return true;
+    }
+
+    waiter->fiber = NULL;
+    while (!waiter->ready)
+    {
+        if (!step(vm, loop))
+            return false;
+    }
+
+    const uint32_t result = waiter->result;
+    ntFree(waiter);
+    return ntPush32(vm, result);
+}
+#endif
+
+bool ntWaitFd(NT_VM *vm, int fd, uint32_t events, NT_IO_COMPLETE complete, uint64_t data)
+{
+    assert(vm);
+#ifdef NT_EVENT_LOOP
+    LOOP *loop = currentLoop();
+    if (loop)
+    {
+        WAITER *waiter = createWaiter(vm, fd, complete, data);
+        struct epoll_event event = {.events = events | EPOLLONESHOT, .data.ptr = waiter};
+        if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) == 0)
+        {
+            loop->waiting++;
+            return park(vm, loop, waiter);
+        }
+
+        ntFree(waiter);
+        // regular files can't be polled, they are always ready
+        if (errno != EPERM)
+            return false;
+    }
+#endif
+    return ntPush32(vm, complete ? complete(fd, events, data) : events);
+}
+
+bool ntSleep(NT_VM *vm, uint32_t milliseconds)
+{
+    assert(vm);
+#ifdef NT_EVENT_LOOP
+    LOOP *loop = currentLoop();
+    if (loop)
+    {
+        WAITER *waiter = createWaiter(vm, -1, NULL, 0);
+        pushTimer(loop, (TIMER){.deadline = now() + milliseconds, .waiter = waiter});
+        return park(vm, loop, waiter);
+    }
+#endif
+
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    const struct timespec time = {
+        .tv_sec = milliseconds / 1000,
+        .tv_nsec = (long)(milliseconds % 1000) * 1000000,
+    };
+    nanosleep(&time, NULL);
+#endif
+    return ntPush32(vm, 0);
+}
+
+bool ntAwaitFd(NT_VM *vm, int fd, uint32_t events)
+{
+    assert(vm);
+#ifdef NT_EVENT_LOOP
+    LOOP *loop = threadLoop;
+    if (!loop || (loop->waiting == 0 && timerCount(loop) == 0))
+        return true;
+
+    WAITER *waiter = createWaiter(vm, fd, NULL, 0);
+    waiter->fiber = NULL;
+    struct epoll_event event = {.events = events | EPOLLONESHOT, .data.ptr = waiter};
+    if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        ntFree(waiter);
+        return errno == EPERM;
+    }
+
+    loop->waiting++;
+    uint32_t value;
+    return park(vm, loop, waiter) && ntPop32(vm, &value);
+#else
+    (void)fd;
+    (void)events;
+    return true;
+#endif
+}
+
+bool ntRunLoop(NT_VM *vm)
+{
+    assert(vm);
+#ifdef NT_EVENT_LOOP
+    LOOP *loop = threadLoop;
+    while (loop && (loop->waiting > 0 || timerCount(loop) > 0))
+    {
+        if (!step(vm, loop))
+            return false;
+    }
+#endif
+    return true;
+}
+
+#ifdef NT_POSIX_IO
+static uint32_t readInt(int fd, uint32_t events, uint64_t data)
+{
+    (void)events;
+    (void)data;
+    uint32_t value;
+    return read(fd, &value, sizeof(value)) == sizeof(value) ? value : UINT32_MAX;
+}
+
+static uint32_t writeInt(int fd, uint32_t events, uint64_t data)
+{
+    (void)events;
+    const uint32_t value = (uint32_t)data;
+    return write(fd, &value, sizeof(value)) == sizeof(value) ? sizeof(value) : UINT32_MAX;
+}
+
+static bool pushPair(NT_VM *vm, const int fds[2])
+{
+    return ntPush64(vm, (uint64_t)(uint32_t)fds[1] << 32 | (uint32_t)fds[0]);
+}
+#endif
+
+static const NT_DELEGATE_TYPE *IoReadType = NULL;
+static bool ioRead(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoReadType);
+
+    uint32_t fd;
+    if (!ntPop32(vm, &fd))
+        return false;
+#ifdef NT_POSIX_IO
+    return ntWaitFd(vm, (int)fd, NT_IO_READ, readInt, 0);
+#else
+    return false;
+#endif
+}
+
+static const NT_DELEGATE_TYPE *IoWriteType = NULL;
+static bool ioWrite(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoWriteType);
+
+    uint32_t fd;
+    uint32_t value;
+    if (!ntPop32(vm, &value) || !ntPop32(vm, &fd))
+        return false;
+#ifdef NT_POSIX_IO
+    return ntWaitFd(vm, (int)fd, NT_IO_WRITE, writeInt, value);
+#else
+    return false;
+#endif
+}
+
+static const NT_DELEGATE_TYPE *IoReadableType = NULL;
+static bool ioReadable(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoReadableType);
+
+    uint32_t fd;
+    return ntPop32(vm, &fd) && ntWaitFd(vm, (int)fd, NT_IO_READ, NULL, 0);
+}
+
+static const NT_DELEGATE_TYPE *IoWritableType = NULL;
+static bool ioWritable(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoWritableType);
+
+    uint32_t fd;
+    return ntPop32(vm, &fd) && ntWaitFd(vm, (int)fd, NT_IO_WRITE, NULL, 0);
+}
+
+static const NT_DELEGATE_TYPE *IoSleepType = NULL;
+static bool ioSleep(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoSleepType);
+
+    uint32_t milliseconds;
+    return ntPop32(vm, &milliseconds) && ntSleep(vm, milliseconds);
+}
+
+static const NT_DELEGATE_TYPE *IoRunType = NULL;
+static bool ioRun(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoRunType);
+
+    return ntRunLoop(vm);
+}
+
+static const NT_DELEGATE_TYPE *IoPipeType = NULL;
+static bool ioPipe(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoPipeType);
+
+#ifdef NT_POSIX_IO
+    int fds[2];
+    return pipe(fds) == 0 && pushPair(vm, fds);
+#else
+    return false;
+#endif
+}
+
+static const NT_DELEGATE_TYPE *IoSocketPairType = NULL;
+static bool ioSocketPair(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoSocketPairType);
+
+#ifdef NT_POSIX_IO
+    int fds[2];
+    return socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0 && pushPair(vm, fds);
+#else
+    return false;
+#endif
+}
+
+static const NT_DELEGATE_TYPE *IoCloseType = NULL;
+static bool ioClose(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == IoCloseType);
+
+    uint32_t fd;
+    if (!ntPop32(vm, &fd))
+        return false;
+#ifdef NT_POSIX_IO
+    return close((int)fd) == 0;
+#else
+    return false;
+#endif
+}
+
+static const NT_DELEGATE_TYPE *addFunction(const char_t *name, const NT_TYPE *returnType,
+                                           const size_t paramCount, const char_t *const *names,
+                                           nativeFun func)
+{
+    NT_PARAM params[2];
+    assert(paramCount <= sizeof(params) / sizeof(NT_PARAM));
+    for (size_t i = 0; i < paramCount; ++i)
+    {
+        params[i].type = ntI32Type();
+        params[i].name = ntCopyString(names[i], ntStrLen(names[i]));
+    }
+    return ntCreateNativeFunction(&IO_MODULE, name, returnType, paramCount, params, func, true);
+}
+
+const NT_MODULE *ntIoModule(void)
+{
+    if (IO_MODULE.type.object.type == NULL)
+    {
+        ntInitModule(&IO_MODULE);
+        ntMakeConstant((NT_OBJECT *)&IO_MODULE);
+        const char_t *moduleName = U"io";
+        IO_MODULE.type.typeName = ntCopyString(moduleName, ntStrLen(moduleName));
+        ntInitSymbolTable(&IO_MODULE.type.fields, (NT_SYMBOL_TABLE *)&ntType()->fields,
+                          STT_TYPE, NULL);
+
+        const char_t *const fd[] = {U"fd"};
+        const char_t *const fdValue[] = {U"fd", U"value"};
+        const char_t *const milliseconds[] = {U"milliseconds"};
+        IoReadType = addFunction(U"read", ntI32Type(), 1, fd, ioRead);
+        IoWriteType = addFunction(U"write", ntI32Type(), 2, fdValue, ioWrite);
+        IoReadableType = addFunction(U"readable", ntI32Type(), 1, fd, ioReadable);
+        IoWritableType = addFunction(U"writable", ntI32Type(), 1, fd, ioWritable);
+        IoSleepType = addFunction(U"sleep", ntI32Type(), 1, milliseconds, ioSleep);
+        IoRunType = addFunction(U"run", NULL, 0, NULL, ioRun);
+        IoPipeType = addFunction(U"pipe", ntI64Type(), 0, NULL, ioPipe);
+        IoSocketPairType = addFunction(U"socketpair", ntI64Type(), 0, NULL, ioSocketPair);
+        IoCloseType = addFunction(U"close", NULL, 1, fd, ioClose);
+    }
+
+    return &IO_MODULE;
+}
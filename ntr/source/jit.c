@@ -0,0 +1,1288 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <netuno/jit.h>
+
+#ifdef NT_JIT
+
+#include <assert.h>
+#include <netuno/array.h>
+#include <netuno/delegate.h>
+#include <netuno/memory.h>
+#include <netuno/module.h>
+#include <netuno/opcode.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// compiled bodies take the stack top and return it after their RETURN, or NULL when a call
+// they made failed
+typedef uint8_t *(*JIT_CODE)(NT_VM *vm, uint8_t *top);
+// compiled traces store the stack top and return where the interpreter resumes, or NULL when a
+// call they made failed
+typedef const NT_INSTRUCTION *(*JIT_TRACE)(NT_VM *vm, uint8_t *top);
+
+// the mapping starts with its size and the loop header of a trace, the code follows
+#define JIT_HEADER 16
+
+enum
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+};
+
+enum
+{
+    CC_B = 0x2,
+    CC_AE = 0x3,
+    CC_E = 0x4,
+    CC_NE = 0x5,
+    CC_BE = 0x6,
+    CC_A = 0x7,
+    CC_P = 0xA,
+    CC_NP = 0xB,
+    CC_L = 0xC,
+    CC_GE = 0xD,
+    CC_LE = 0xE,
+    CC_G = 0xF,
+};
+
+// opcodes are packed most significant byte first, prefixes included
+enum
+{
+    ADD = 0x03,
+    SUB = 0x2B,
+    AND = 0x23,
+    OR = 0x0B,
+    XOR = 0x33,
+    CMP = 0x3B,
+    IMUL = 0x0FAF,
+    MOV_LOAD = 0x8B,
+    MOV_STORE = 0x89,
+    MOVSX_64 = 0x4863,
+    LEA_64 = 0x488D,
+    GROUP_F7 = 0xF7,
+    GROUP_81 = 0x81,
+    GROUP_83 = 0x83,
+    JMP = 0xE9,
+    JCC = 0x0F80,
+    SETCC = 0x0F90,
+    MOVZX_8 = 0x0FB6,
+    MOVSS_LOAD = 0xF30F10,
+    MOVSS_STORE = 0xF30F11,
+    MOVSD_LOAD = 0xF20F10,
+    MOVSD_STORE = 0xF20F11,
+    ADDSS = 0xF30F58,
+    SUBSS = 0xF30F5C,
+    MULSS = 0xF30F59,
+    DIVSS = 0xF30F5E,
+    ADDSD = 0xF20F58,
+    SUBSD = 0xF20F5C,
+    MULSD = 0xF20F59,
+    DIVSD = 0xF20F5E,
+    UCOMISS = 0x0F2E,
+    UCOMISD = 0x660F2E,
+};
+
+#define REX_W64(opcode) (0x4800 | (opcode))
+
+typedef struct
+{
+    size_t offset;
+    size_t target;
+} FIXUP;
+
+typedef struct
+{
+    const NT_MODULE *module;
+    // function being compiled, NULL for traces
+    const NT_DELEGATE *delegate;
+    NT_ARRAY code;
+    NT_ARRAY fixups;
+    // code offset of every reachable instruction, offsets[instructionCount] is the bail out
+    size_t *offsets;
+} JIT;
+
+static void emit8(JIT *jit, uint8_t value)
+{
+    ntArrayAdd(&jit->code, &value, sizeof(uint8_t));
+}
+
+static void emit32(JIT *jit, uint32_t value)
+{
+    ntArrayAdd(&jit->code, &value, sizeof(uint32_t));
+}
+
+static void emit64(JIT *jit, uint64_t value)
+{
+    ntArrayAdd(&jit->code, &value, sizeof(uint64_t));
+}
+
+static void emitOpcode(JIT *jit, uint32_t opcode)
+{
+    bool started = false;
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        const uint8_t byte = (uint8_t)(opcode >> shift);
+        started = started || byte != 0 || shift == 0;
+        if (started)
+            emit8(jit, byte);
+    }
+}
+
+// opcode with a [rbx + disp32] operand, rbx holding the stack top
+static void emitMem(JIT *jit, uint32_t opcode, uint8_t reg, int32_t disp)
+{
+    emitOpcode(jit, opcode);
+    emit8(jit, 0x80 | (reg << 3) | RBX);
+    emit32(jit, (uint32_t)disp);
+}
+
+static void emitReg(JIT *jit, uint32_t opcode, uint8_t reg, uint8_t rm)
+{
+    emitOpcode(jit, opcode);
+    emit8(jit, 0xC0 | (reg << 3) | rm);
+}
+
+static void emitAdjust(JIT *jit, int32_t delta)
+{
+    if (delta != 0)
+        emitMem(jit, LEA_64, RBX, delta);
+}
+
+static void emitJump(JIT *jit, uint32_t opcode, size_t target)
+{
+    emitOpcode(jit, opcode);
+    const FIXUP fixup = {.offset = jit->code.count, .target = target};
+    ntArrayAdd(&jit->fixups, &fixup, sizeof(FIXUP));
+    emit32(jit, 0);
+}
+
+static void emitSet(JIT *jit, uint8_t cc)
+{
+    emitReg(jit, SETCC | cc, 0, RAX);
+    emitReg(jit, MOVZX_8, RAX, RAX);
+}
+
+static void emitPrologue(JIT *jit)
+{
+    static const uint8_t prologue[] = {
+        0x53, // push rbx
+        0x41, 0x54, // push r12
+        0x48, 0x83, 0xEC, 0x08, // sub rsp, 8
+        0x49, 0x89, 0xFC, // mov r12, rdi
+        0x48, 0x89, 0xF3, // mov rbx, rsi
+    };
+    ntArrayAdd(&jit->code, prologue, sizeof(prologue));
+}
+
+static void emitEpilogue(JIT *jit)
+{
+    static const uint8_t epilogue[] = {
+        0x48, 0x83, 0xC4, 0x08, // add rsp, 8
+        0x41, 0x5C, // pop r12
+        0x5B, // pop rbx
+        0xC3, // ret
+    };
+    ntArrayAdd(&jit->code, epilogue, sizeof(epilogue));
+}
+
+static void emitReturn(JIT *jit)
+{
+    emitReg(jit, REX_W64(MOV_STORE), RBX, RAX);
+    emitEpilogue(jit);
+}
+
+// returns NULL to whoever entered the compiled code
+static void emitBail(JIT *jit)
+{
+    jit->offsets[jit->module->instructionCount] = jit->code.count;
+    emitReg(jit, 0x31, RAX, RAX); // xor eax, eax
+    emitEpilogue(jit);
+}
+
+static void emitConst32(JIT *jit, uint32_t value)
+{
+    emitMem(jit, 0xC7, 0, 0);
+    emit32(jit, value);
+    emitAdjust(jit, sizeof(uint32_t));
+}
+
+static void emitConst64(JIT *jit, uint64_t value)
+{
+    emitOpcode(jit, 0x48B8); // mov rax, imm64
+    emit64(jit, value);
+    emitMem(jit, REX_W64(MOV_STORE), RAX, 0);
+    emitAdjust(jit, sizeof(uint64_t));
+}
+
+static void emitBinary32(JIT *jit, uint32_t opcode)
+{
+    emitMem(jit, MOV_LOAD, RAX, -8);
+    emitMem(jit, opcode, RAX, -4);
+    emitMem(jit, MOV_STORE, RAX, -8);
+    emitAdjust(jit, -4);
+}
+
+static void emitBinary64(JIT *jit, uint32_t opcode)
+{
+    emitMem(jit, REX_W64(MOV_LOAD), RAX, -16);
+    emitMem(jit, opcode, RAX, -8);
+    emitMem(jit, REX_W64(MOV_STORE), RAX, -16);
+    emitAdjust(jit, -8);
+}
+
+// integer division leaves the quotient in eax and the remainder in edx
+static void emitDivide32(JIT *jit, bool sign, uint8_t result)
+{
+    emitMem(jit, MOV_LOAD, RAX, -8);
+    if (sign)
+        emit8(jit, 0x99); // cdq
+    else
+        emitReg(jit, 0x31, RDX, RDX); // xor edx, edx
+    emitMem(jit, GROUP_F7, sign ? 7 : 6, -4);
+    emitMem(jit, MOV_STORE, result, -8);
+    emitAdjust(jit, -4);
+}
+
+static void emitShift32(JIT *jit, uint8_t operation)
+{
+    emitMem(jit, MOV_LOAD, RAX, -8);
+    emitMem(jit, MOV_LOAD, RCX, -4);
+    emitReg(jit, 0xD3, operation, RAX);
+    emitMem(jit, MOV_STORE, RAX, -8);
+    emitAdjust(jit, -4);
+}
+
+static void emitCompare32(JIT *jit, uint8_t cc)
+{
+    emitMem(jit, MOV_LOAD, RAX, -8);
+    emitMem(jit, CMP, RAX, -4);
+    emitSet(jit, cc);
+    emitMem(jit, MOV_STORE, RAX, -8);
+    emitAdjust(jit, -4);
+}
+
+static void emitCompare64(JIT *jit, uint8_t cc)
+{
+    emitMem(jit, REX_W64(MOV_LOAD), RAX, -16);
+    emitMem(jit, REX_W64(CMP), RAX, -8);
+    emitSet(jit, cc);
+    emitMem(jit, MOV_STORE, RAX, -16);
+    emitAdjust(jit, -12);
+}
+
+static void emitFloatBinary(JIT *jit, size_t size, uint32_t opcode)
+{
+    const int32_t left = -2 * (int32_t)size;
+    const int32_t right = -(int32_t)size;
+    emitMem(jit, size == sizeof(float) ? MOVSS_LOAD : MOVSD_LOAD, 0, left);
+    emitMem(jit, opcode, 0, right);
+    emitMem(jit, size == sizeof(float) ? MOVSS_STORE : MOVSD_STORE, 0, left);
+    emitAdjust(jit, right);
+}
+
+// unordered operands fail every comparison but NE, like the C operators run() uses
+static void emitFloatCompare(JIT *jit, size_t size, uint8_t cc, bool swap)
+{
+    const int32_t left = -2 * (int32_t)size;
+    const int32_t right = -(int32_t)size;
+    const uint32_t load = size == sizeof(float) ? MOVSS_LOAD : MOVSD_LOAD;
+    emitMem(jit, load, 0, left);
+    emitMem(jit, load, 1, right);
+    if (swap)
+        emitReg(jit, size == sizeof(float) ? UCOMISS : UCOMISD, 1, 0);
+    else
+        emitReg(jit, size == sizeof(float) ? UCOMISS : UCOMISD, 0, 1);
+
+    if (cc == CC_E || cc == CC_NE)
+    {
+        emitReg(jit, SETCC | cc, 0, RAX);
+        emitReg(jit, SETCC | (cc == CC_E ? CC_NP : CC_P), 0, RCX);
+        emitReg(jit, cc == CC_E ? 0x20 : 0x08, RCX, RAX); // and/or al, cl
+        emitReg(jit, MOVZX_8, RAX, RAX);
+    }
+    else
+        emitSet(jit, cc);
+
+    emitMem(jit, MOV_STORE, RAX, left);
+    emitAdjust(jit, left + (int32_t)sizeof(uint32_t));
+}
+
+static void emitRegisterBinary(JIT *jit, const NT_INSTRUCTION *instruction, uint32_t opcode,
+                               uint8_t cc, bool constant)
+{
+    emitMem(jit, MOV_LOAD, RAX, instruction->left);
+    if (!constant)
+        emitMem(jit, opcode, RAX, instruction->right);
+    else if (opcode == IMUL)
+    {
+        emitReg(jit, 0x69, RAX, RAX); // imul eax, eax, imm32
+        emit32(jit, (uint32_t)instruction->right);
+    }
+    else
+    {
+        // the eax forms of the immediate instructions sit 2 above their r32, r/m32 form
+        emit8(jit, (uint8_t)(opcode + 2));
+        emit32(jit, (uint32_t)instruction->right);
+    }
+
+    if (opcode == CMP)
+        emitSet(jit, cc);
+    emitMem(jit, MOV_STORE, RAX, instruction->dst);
+    emitAdjust(jit, instruction->delta);
+}
+
+// helper called by compiled code for every CALL, interpreting or entering the callee
+static uint8_t *jitCall(NT_VM *vm, uint8_t *top, const NT_DELEGATE *delegate)
+{
+    vm->stackTop = top;
+    if (!ntInvoke(vm, delegate))
+        return NULL;
+    return vm->stackTop;
+}
+
+static void emitCall(JIT *jit)
+{
+    static const uint8_t call[] = {
+        0x4C, 0x89, 0xE7, // mov rdi, r12
+        0x48, 0xB8, // mov rax, jitCall
+    };
+    ntArrayAdd(&jit->code, call, sizeof(call));
+    emit64(jit, (uint64_t)(uintptr_t)jitCall);
+    emitReg(jit, 0xFF, 2, RAX); // call rax
+    emitReg(jit, REX_W64(0x85), RAX, RAX); // test rax, rax
+    emitJump(jit, JCC | CC_E, jit->module->instructionCount);
+    emitReg(jit, REX_W64(MOV_STORE), RAX, RBX);
+}
+
+static size_t instructionIndex(const JIT *jit, const NT_INSTRUCTION *instruction)
+{
+    return (size_t)(instruction - jit->module->instructions);
+}
+
+// sets the flags for a conditional branch, cc receives the condition under which it is taken
+static bool emitBranchTest(JIT *jit, const NT_INSTRUCTION *instruction, uint8_t *cc)
+{
+    switch (instruction->opcode)
+    {
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_NZ_32:
+        emitMem(jit, GROUP_83, 7, -4);
+        emit8(jit, 0);
+        *cc = instruction->opcode == BC_BRANCH_Z_32 ? CC_E : CC_NE;
+        return true;
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_64:
+        emitMem(jit, REX_W64(GROUP_83), 7, -8);
+        emit8(jit, 0);
+        *cc = instruction->opcode == BC_BRANCH_Z_64 ? CC_E : CC_NE;
+        return true;
+
+#define JIT_COMPARE_BRANCH_Z(op, compare)                                                          \
+    case BC_##op##_BRANCH_Z:                                                                       \
+        emitCompare32(jit, compare);                                                               \
+        emitReg(jit, 0x85, RAX, RAX);                                                              \
+        *cc = CC_E;                                                                                \
+        return true;
+
+        JIT_COMPARE_BRANCH_Z(EQ_32, CC_E)
+        JIT_COMPARE_BRANCH_Z(NE_32, CC_NE)
+        JIT_COMPARE_BRANCH_Z(GT_I32, CC_G)
+        JIT_COMPARE_BRANCH_Z(GT_U32, CC_A)
+        JIT_COMPARE_BRANCH_Z(LT_I32, CC_L)
+        JIT_COMPARE_BRANCH_Z(LT_U32, CC_B)
+        JIT_COMPARE_BRANCH_Z(GE_I32, CC_GE)
+        JIT_COMPARE_BRANCH_Z(GE_U32, CC_AE)
+        JIT_COMPARE_BRANCH_Z(LE_I32, CC_LE)
+        JIT_COMPARE_BRANCH_Z(LE_U32, CC_BE)
+#undef JIT_COMPARE_BRANCH_Z
+
+    default:
+        return false;
+    }
+}
+
+static const NT_INSTRUCTION *traceHeader(const NT_INSTRUCTION *instruction)
+{
+    assert(instruction->opcode == BC_LOOP_TRACE);
+    const NT_INSTRUCTION *header;
+    memcpy(&header, (uint8_t *)(uintptr_t)instruction->value64 - JIT_HEADER + sizeof(size_t),
+           sizeof(header));
+    return header;
+}
+
+static bool emitInstruction(JIT *jit, const NT_INSTRUCTION *instruction)
+{
+    const int32_t operand = (int32_t)instruction->operand;
+    switch (instruction->opcode)
+    {
+    case BC_ZERO_32:
+    case BC_ZERO_F32:
+        emitConst32(jit, 0);
+        break;
+    case BC_ONE_32:
+        emitConst32(jit, 1);
+        break;
+    case BC_ONE_F32:
+        emitConst32(jit, 0x3F800000);
+        break;
+    case BC_CONST_32:
+        emitConst32(jit, instruction->value32);
+        break;
+    case BC_ZERO_64:
+    case BC_ZERO_F64:
+        emitConst64(jit, 0);
+        break;
+    case BC_ONE_64:
+        emitConst64(jit, 1);
+        break;
+    case BC_ONE_F64:
+        emitConst64(jit, 0x3FF0000000000000);
+        break;
+    case BC_CONST_64:
+        emitConst64(jit, instruction->value64);
+        break;
+    case BC_CONST_OBJECT:
+        emitConst64(jit, (uint64_t)(uintptr_t)instruction->object);
+        break;
+
+    case BC_POP:
+        emitAdjust(jit, -operand);
+        break;
+    case BC_POP_32:
+        emitAdjust(jit, -4);
+        break;
+    case BC_POP_64:
+        emitAdjust(jit, -8);
+        break;
+    case BC_LOAD_SP_32:
+        emitMem(jit, MOV_LOAD, RAX, -4 - operand);
+        emitMem(jit, MOV_STORE, RAX, 0);
+        emitAdjust(jit, 4);
+        break;
+    case BC_LOAD_SP_64:
+        emitMem(jit, REX_W64(MOV_LOAD), RAX, -8 - operand);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, 0);
+        emitAdjust(jit, 8);
+        break;
+    case BC_STORE_SP_32:
+        emitMem(jit, MOV_LOAD, RAX, -4);
+        emitMem(jit, MOV_STORE, RAX, -4 - operand);
+        break;
+    case BC_STORE_SP_64:
+        emitMem(jit, REX_W64(MOV_LOAD), RAX, -8);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -8 - operand);
+        break;
+
+    case BC_ADD_I32:
+        emitBinary32(jit, ADD);
+        break;
+    case BC_SUB_I32:
+        emitBinary32(jit, SUB);
+        break;
+    case BC_MUL_I32:
+        emitBinary32(jit, IMUL);
+        break;
+    case BC_AND_I32:
+        emitBinary32(jit, AND);
+        break;
+    case BC_OR_I32:
+        emitBinary32(jit, OR);
+        break;
+    case BC_XOR_I32:
+        emitBinary32(jit, XOR);
+        break;
+    case BC_ADD_I64:
+        emitBinary64(jit, REX_W64(ADD));
+        break;
+    case BC_SUB_I64:
+        emitBinary64(jit, REX_W64(SUB));
+        break;
+    case BC_MUL_I64:
+        emitBinary64(jit, 0x480FAF);
+        break;
+    case BC_AND_I64:
+        emitBinary64(jit, REX_W64(AND));
+        break;
+    case BC_OR_I64:
+        emitBinary64(jit, REX_W64(OR));
+        break;
+    case BC_XOR_I64:
+        emitBinary64(jit, REX_W64(XOR));
+        break;
+    case BC_DIV_I32:
+        emitDivide32(jit, true, RAX);
+        break;
+    case BC_DIV_U32:
+        emitDivide32(jit, false, RAX);
+        break;
+    case BC_REM_I32:
+        emitDivide32(jit, true, RDX);
+        break;
+    case BC_REM_U32:
+        emitDivide32(jit, false, RDX);
+        break;
+    case BC_SHL_I32:
+        emitShift32(jit, 4);
+        break;
+    case BC_SHR_U32:
+        emitShift32(jit, 5);
+        break;
+    case BC_SHR_I32:
+        emitShift32(jit, 7);
+        break;
+    case BC_NEG_I32:
+        emitMem(jit, GROUP_F7, 3, -4);
+        break;
+    case BC_NEG_I64:
+        emitMem(jit, REX_W64(GROUP_F7), 3, -8);
+        break;
+    case BC_NOT_32:
+        emitMem(jit, GROUP_F7, 2, -4);
+        break;
+    case BC_NOT_64:
+        emitMem(jit, REX_W64(GROUP_F7), 2, -8);
+        break;
+    case BC_IS_ZERO_32:
+    case BC_IS_NOT_ZERO_32:
+        emitMem(jit, GROUP_83, 7, -4);
+        emit8(jit, 0);
+        emitSet(jit, instruction->opcode == BC_IS_ZERO_32 ? CC_E : CC_NE);
+        emitMem(jit, MOV_STORE, RAX, -4);
+        break;
+    case BC_IS_ZERO_64:
+    case BC_IS_NOT_ZERO_64:
+        emitMem(jit, REX_W64(GROUP_83), 7, -8);
+        emit8(jit, 0);
+        emitSet(jit, instruction->opcode == BC_IS_ZERO_64 ? CC_E : CC_NE);
+        emitMem(jit, MOV_STORE, RAX, -8);
+        emitAdjust(jit, -4);
+        break;
+
+    case BC_EQ_32:
+        emitCompare32(jit, CC_E);
+        break;
+    case BC_NE_32:
+        emitCompare32(jit, CC_NE);
+        break;
+    case BC_GT_I32:
+        emitCompare32(jit, CC_G);
+        break;
+    case BC_GT_U32:
+        emitCompare32(jit, CC_A);
+        break;
+    case BC_LT_I32:
+        emitCompare32(jit, CC_L);
+        break;
+    case BC_LT_U32:
+        emitCompare32(jit, CC_B);
+        break;
+    case BC_GE_I32:
+        emitCompare32(jit, CC_GE);
+        break;
+    case BC_GE_U32:
+        emitCompare32(jit, CC_AE);
+        break;
+    case BC_LE_I32:
+        emitCompare32(jit, CC_LE);
+        break;
+    case BC_LE_U32:
+        emitCompare32(jit, CC_BE);
+        break;
+    case BC_EQ_64:
+        emitCompare64(jit, CC_E);
+        break;
+    case BC_NE_64:
+        emitCompare64(jit, CC_NE);
+        break;
+    case BC_GT_I64:
+        emitCompare64(jit, CC_G);
+        break;
+    case BC_GT_U64:
+        emitCompare64(jit, CC_A);
+        break;
+    case BC_LT_I64:
+        emitCompare64(jit, CC_L);
+        break;
+    case BC_LT_U64:
+        emitCompare64(jit, CC_B);
+        break;
+    case BC_GE_I64:
+        emitCompare64(jit, CC_GE);
+        break;
+    case BC_GE_U64:
+        emitCompare64(jit, CC_AE);
+        break;
+    case BC_LE_I64:
+        emitCompare64(jit, CC_LE);
+        break;
+    case BC_LE_U64:
+        emitCompare64(jit, CC_BE);
+        break;
+
+    case BC_ADD_F32:
+        emitFloatBinary(jit, sizeof(float), ADDSS);
+        break;
+    case BC_SUB_F32:
+        emitFloatBinary(jit, sizeof(float), SUBSS);
+        break;
+    case BC_MUL_F32:
+        emitFloatBinary(jit, sizeof(float), MULSS);
+        break;
+    case BC_DIV_F32:
+        emitFloatBinary(jit, sizeof(float), DIVSS);
+        break;
+    case BC_ADD_F64:
+        emitFloatBinary(jit, sizeof(double), ADDSD);
+        break;
+    case BC_SUB_F64:
+        emitFloatBinary(jit, sizeof(double), SUBSD);
+        break;
+    case BC_MUL_F64:
+        emitFloatBinary(jit, sizeof(double), MULSD);
+        break;
+    case BC_DIV_F64:
+        emitFloatBinary(jit, sizeof(double), DIVSD);
+        break;
+    case BC_NEG_F32:
+        emitMem(jit, GROUP_81, 6, -4); // xor with the sign bit
+        emit32(jit, 0x80000000);
+        break;
+    case BC_NEG_F64:
+        emitMem(jit, 0x480FBA, 7, -8); // btc on the sign bit
+        emit8(jit, 63);
+        break;
+    case BC_EQ_F32:
+        emitFloatCompare(jit, sizeof(float), CC_E, false);
+        break;
+    case BC_NE_F32:
+        emitFloatCompare(jit, sizeof(float), CC_NE, false);
+        break;
+    case BC_GT_F32:
+        emitFloatCompare(jit, sizeof(float), CC_A, false);
+        break;
+    case BC_GE_F32:
+        emitFloatCompare(jit, sizeof(float), CC_AE, false);
+        break;
+    case BC_LT_F32:
+        emitFloatCompare(jit, sizeof(float), CC_A, true);
+        break;
+    case BC_LE_F32:
+        emitFloatCompare(jit, sizeof(float), CC_AE, true);
+        break;
+    case BC_EQ_F64:
+        emitFloatCompare(jit, sizeof(double), CC_E, false);
+        break;
+    case BC_NE_F64:
+        emitFloatCompare(jit, sizeof(double), CC_NE, false);
+        break;
+    case BC_GT_F64:
+        emitFloatCompare(jit, sizeof(double), CC_A, false);
+        break;
+    case BC_GE_F64:
+        emitFloatCompare(jit, sizeof(double), CC_AE, false);
+        break;
+    case BC_LT_F64:
+        emitFloatCompare(jit, sizeof(double), CC_A, true);
+        break;
+    case BC_LE_F64:
+        emitFloatCompare(jit, sizeof(double), CC_AE, true);
+        break;
+
+    case BC_EXTEND_I32:
+        emitMem(jit, MOVSX_64, RAX, -4);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -4);
+        emitAdjust(jit, 4);
+        break;
+    case BC_EXTEND_U32:
+        emitMem(jit, MOV_LOAD, RAX, -4);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -4);
+        emitAdjust(jit, 4);
+        break;
+    case BC_WRAP_I64:
+        emitAdjust(jit, -4);
+        break;
+    case BC_PROMOTE_F32:
+        emitMem(jit, 0xF30F5A, 0, -4); // cvtss2sd
+        emitMem(jit, MOVSD_STORE, 0, -4);
+        emitAdjust(jit, 4);
+        break;
+    case BC_DEMOTE_F64:
+        emitMem(jit, 0xF20F5A, 0, -8); // cvtsd2ss
+        emitMem(jit, MOVSS_STORE, 0, -8);
+        emitAdjust(jit, -4);
+        break;
+    case BC_CONVERT_F32_I32:
+        emitMem(jit, 0xF30F2A, 0, -4); // cvtsi2ss
+        emitMem(jit, MOVSS_STORE, 0, -4);
+        break;
+    case BC_CONVERT_F64_I32:
+        emitMem(jit, 0xF20F2A, 0, -4); // cvtsi2sd
+        emitMem(jit, MOVSD_STORE, 0, -4);
+        emitAdjust(jit, 4);
+        break;
+    case BC_CONVERT_F32_I64:
+        emitMem(jit, 0xF3480F2A, 0, -8);
+        emitMem(jit, MOVSS_STORE, 0, -8);
+        emitAdjust(jit, -4);
+        break;
+    case BC_CONVERT_F64_I64:
+        emitMem(jit, 0xF2480F2A, 0, -8);
+        emitMem(jit, MOVSD_STORE, 0, -8);
+        break;
+    case BC_TRUNCATE_I32_F32:
+        emitMem(jit, 0xF30F2C, RAX, -4); // cvttss2si
+        emitMem(jit, MOV_STORE, RAX, -4);
+        break;
+    case BC_TRUNCATE_I32_F64:
+        emitMem(jit, 0xF20F2C, RAX, -8); // cvttsd2si
+        emitMem(jit, MOV_STORE, RAX, -8);
+        emitAdjust(jit, -4);
+        break;
+    case BC_TRUNCATE_I64_F32:
+        emitMem(jit, 0xF3480F2C, RAX, -4);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -4);
+        emitAdjust(jit, 4);
+        break;
+    case BC_TRUNCATE_I64_F64:
+        emitMem(jit, 0xF2480F2C, RAX, -8);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -8);
+        break;
+
+    case BC_BRANCH:
+        emitJump(jit, JMP, instructionIndex(jit, instruction->target));
+        break;
+    case BC_LOOP_TRACE:
+        // the function is compiled whole, its loops need no trace
+        emitJump(jit, JMP, instructionIndex(jit, traceHeader(instruction)));
+        break;
+
+    case BC_CALL:
+        emitMem(jit, REX_W64(MOV_LOAD), RDX, -8);
+        emitMem(jit, LEA_64, 6, -8); // lea rsi, [rbx - 8]
+        emitCall(jit);
+        break;
+    case BC_CALL_DIRECT:
+        emitReg(jit, REX_W64(MOV_STORE), RBX, 6); // mov rsi, rbx
+        emitOpcode(jit, 0x48BA); // mov rdx, imm64
+        emit64(jit, (uint64_t)(uintptr_t)instruction->object);
+        emitCall(jit);
+        break;
+    case BC_TAIL_CALL: {
+        // a function calling itself becomes a loop, other tail calls stay interpreted
+        if (!jit->delegate || instruction->object != (const NT_OBJECT *)jit->delegate)
+            return false;
+        const int32_t size = (int32_t)jit->delegate->paramsSize;
+        for (int32_t offset = 0; offset < size; offset += sizeof(uint32_t))
+        {
+            emitMem(jit, MOV_LOAD, RAX, offset - size);
+            emitMem(jit, MOV_STORE, RAX, offset - size - operand);
+        }
+        emitAdjust(jit, -operand);
+        emitJump(jit, JMP, instructionIndex(jit, jit->delegate->entry));
+        break;
+    }
+    case BC_RETURN:
+        emitReturn(jit);
+        break;
+    case BC_RETURN_32:
+        emitMem(jit, MOV_LOAD, RAX, -4);
+        emitMem(jit, MOV_STORE, RAX, -4 - operand);
+        emitAdjust(jit, -(int32_t)instruction->value32);
+        emitReturn(jit);
+        break;
+    case BC_RETURN_64:
+        emitMem(jit, REX_W64(MOV_LOAD), RAX, -8);
+        emitMem(jit, REX_W64(MOV_STORE), RAX, -8 - operand);
+        emitAdjust(jit, -(int32_t)instruction->value32);
+        emitReturn(jit);
+        break;
+    case BC_POP_RETURN:
+        emitAdjust(jit, -operand);
+        emitReturn(jit);
+        break;
+
+    case BC_ADD_SP_SP_I32:
+    case BC_SUB_SP_SP_I32:
+        emitMem(jit, MOV_LOAD, RAX, -4 - operand);
+        emitMem(jit, instruction->opcode == BC_ADD_SP_SP_I32 ? ADD : SUB, RAX,
+                -4 - (int32_t)instruction->value32);
+        emitMem(jit, MOV_STORE, RAX, 0);
+        emitAdjust(jit, 4);
+        break;
+    case BC_ADD_SP_CONST_I32:
+    case BC_SUB_SP_CONST_I32:
+        emitMem(jit, MOV_LOAD, RAX, -4 - operand);
+        emit8(jit, instruction->opcode == BC_ADD_SP_CONST_I32 ? 0x05 : 0x2D);
+        emit32(jit, instruction->value32);
+        emitMem(jit, MOV_STORE, RAX, 0);
+        emitAdjust(jit, 4);
+        break;
+
+    case BC_REG_ADJUST:
+        emitAdjust(jit, instruction->delta);
+        break;
+    case BC_REG_MOVE_32:
+        emitMem(jit, MOV_LOAD, RAX, instruction->left);
+        emitMem(jit, MOV_STORE, RAX, instruction->dst);
+        emitAdjust(jit, instruction->delta);
+        break;
+    case BC_REG_MOVE_32_K:
+        emitMem(jit, 0xC7, 0, instruction->dst);
+        emit32(jit, (uint32_t)instruction->right);
+        emitAdjust(jit, instruction->delta);
+        break;
+
+#define JIT_REGISTER_BINARY(op, opcode, cc)                                                        \
+    case BC_REG_##op:                                                                              \
+        emitRegisterBinary(jit, instruction, opcode, cc, false);                                   \
+        break;                                                                                     \
+    case BC_REG_##op##_K:                                                                          \
+        emitRegisterBinary(jit, instruction, opcode, cc, true);                                    \
+        break;
+
+        JIT_REGISTER_BINARY(ADD_I32, ADD, 0)
+        JIT_REGISTER_BINARY(SUB_I32, SUB, 0)
+        JIT_REGISTER_BINARY(MUL_I32, IMUL, 0)
+        JIT_REGISTER_BINARY(EQ_32, CMP, CC_E)
+        JIT_REGISTER_BINARY(NE_32, CMP, CC_NE)
+        JIT_REGISTER_BINARY(GT_I32, CMP, CC_G)
+        JIT_REGISTER_BINARY(GT_U32, CMP, CC_A)
+        JIT_REGISTER_BINARY(LT_I32, CMP, CC_L)
+        JIT_REGISTER_BINARY(LT_U32, CMP, CC_B)
+        JIT_REGISTER_BINARY(GE_I32, CMP, CC_GE)
+        JIT_REGISTER_BINARY(GE_U32, CMP, CC_AE)
+        JIT_REGISTER_BINARY(LE_I32, CMP, CC_LE)
+        JIT_REGISTER_BINARY(LE_U32, CMP, CC_BE)
+#undef JIT_REGISTER_BINARY
+
+    default: {
+        uint8_t cc;
+        if (!emitBranchTest(jit, instruction, &cc))
+            return false;
+        emitJump(jit, JCC | cc, instructionIndex(jit, instruction->target));
+        break;
+    }
+    }
+    return true;
+}
+
+// marks the instructions control can reach from the entry, the body of the function
+static void markReachable(const JIT *jit, size_t entry, bool *reachable)
+{
+    const size_t count = jit->module->instructionCount;
+    size_t *work = ntMalloc(sizeof(size_t) * count);
+    size_t workCount = 0;
+
+    reachable[entry] = true;
+    work[workCount++] = entry;
+    while (workCount > 0)
+    {
+        const size_t index = work[--workCount];
+        const NT_INSTRUCTION *instruction = &jit->module->instructions[index];
+
+        size_t successors[2];
+        size_t successorCount = 0;
+        switch (instruction->opcode)
+        {
+        case BC_RETURN:
+        case BC_RETURN_32:
+        case BC_RETURN_64:
+        case BC_POP_RETURN:
+        case BC_TAIL_CALL:
+        case BC_HALT:
+            break;
+        case BC_BRANCH:
+            successors[successorCount++] = instructionIndex(jit, instruction->target);
+            break;
+        case BC_LOOP_TRACE:
+            successors[successorCount++] = instructionIndex(jit, traceHeader(instruction));
+            break;
+        case BC_BRANCH_Z_32:
+        case BC_BRANCH_Z_64:
+        case BC_BRANCH_NZ_32:
+        case BC_BRANCH_NZ_64:
+        case BC_EQ_32_BRANCH_Z:
+        case BC_NE_32_BRANCH_Z:
+        case BC_GT_I32_BRANCH_Z:
+        case BC_GT_U32_BRANCH_Z:
+        case BC_LT_I32_BRANCH_Z:
+        case BC_LT_U32_BRANCH_Z:
+        case BC_GE_I32_BRANCH_Z:
+        case BC_GE_U32_BRANCH_Z:
+        case BC_LE_I32_BRANCH_Z:
+        case BC_LE_U32_BRANCH_Z:
+            successors[successorCount++] = instructionIndex(jit, instruction->target);
+            successors[successorCount++] = index + 1;
+            break;
+        default:
+            successors[successorCount++] = index + 1;
+            break;
+        }
+
+        for (size_t i = 0; i < successorCount; ++i)
+        {
+            // verified bodies never run off the code, the HALT sentinel stops them otherwise
+            if (successors[i] < count && !reachable[successors[i]])
+            {
+                reachable[successors[i]] = true;
+                work[workCount++] = successors[i];
+            }
+        }
+    }
+
+    ntFree(work);
+}
+
+static void *install(const NT_ARRAY *code, const NT_INSTRUCTION *header)
+{
+    const size_t size = JIT_HEADER + code->count;
+    uint8_t *memory =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+
+    memcpy(memory, &size, sizeof(size_t));
+    memcpy(memory + sizeof(size_t), &header, sizeof(header));
+    memcpy(memory + JIT_HEADER, code->data, code->count);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, size);
+        return NULL;
+    }
+    return memory + JIT_HEADER;
+}
+
+static void release(void *code)
+{
+    uint8_t *memory = (uint8_t *)code - JIT_HEADER;
+    size_t size;
+    memcpy(&size, memory, sizeof(size_t));
+    munmap(memory, size);
+}
+
+static void resolveFixups(JIT *jit)
+{
+    for (size_t i = 0; i < jit->fixups.count / sizeof(FIXUP); ++i)
+    {
+        FIXUP fixup;
+        ntArrayGet(&jit->fixups, i * sizeof(FIXUP), &fixup, sizeof(FIXUP));
+        const int32_t relative =
+            (int32_t)jit->offsets[fixup.target] - (int32_t)(fixup.offset + sizeof(int32_t));
+        ntArraySet(&jit->code, fixup.offset, &relative, sizeof(int32_t));
+    }
+}
+
+bool ntJitCompile(NT_DELEGATE *delegate)
+{
+    assert(delegate);
+    assert(!delegate->native);
+    assert(delegate->entry);
+
+    JIT jit = {.module = delegate->sourceModule, .delegate = delegate};
+    const size_t count = jit.module->instructionCount;
+    ntInitArray(&jit.code);
+    ntInitArray(&jit.fixups);
+    jit.offsets = ntMalloc(sizeof(size_t) * (count + 1));
+    bool *reachable = ntMalloc(sizeof(bool) * count);
+    memset(reachable, 0, sizeof(bool) * count);
+    markReachable(&jit, instructionIndex(&jit, delegate->entry), reachable);
+
+    emitPrologue(&jit);
+
+    // the body keeps its instruction order, so fall through stays fall through
+    const size_t entry = instructionIndex(&jit, delegate->entry);
+    bool result = true;
+    emitJump(&jit, JMP, entry);
+    for (size_t i = 0; i < count && result; ++i)
+    {
+        if (!reachable[i])
+            continue;
+        jit.offsets[i] = jit.code.count;
+        result = emitInstruction(&jit, &jit.module->instructions[i]);
+    }
+
+    if (result)
+    {
+        emitBail(&jit);
+        resolveFixups(&jit);
+        delegate->jit = install(&jit.code, NULL);
+        result = delegate->jit != NULL;
+    }
+
+    ntFree(reachable);
+    ntFree(jit.offsets);
+    ntDeinitArray(&jit.fixups);
+    ntDeinitArray(&jit.code);
+    return result;
+}
+
+bool ntJitEnter(NT_VM *vm, const NT_DELEGATE *delegate)
+{
+    assert(delegate->jit);
+
+    JIT_CODE code;
+    memcpy(&code, &delegate->jit, sizeof(JIT_CODE));
+    uint8_t *top = code(vm, vm->stackTop);
+    if (!top)
+        return false;
+    vm->stackTop = top;
+    return true;
+}
+
+void ntJitFree(NT_DELEGATE *delegate)
+{
+    if (!delegate->jit)
+        return;
+
+    release(delegate->jit);
+    delegate->jit = NULL;
+}
+
+typedef struct
+{
+    size_t index;
+    bool taken;
+} TRACE_STEP;
+
+// Replays the recorded directions from the loop header. The path must move forward through the
+// loop and use every direction, otherwise the recording left the loop or crossed an inner one.
+static size_t tracePath(const JIT *jit, const NT_TRACE_RECORDER *recorder, TRACE_STEP *path)
+{
+    const size_t loop = instructionIndex(jit, recorder->loop);
+    size_t index = instructionIndex(jit, recorder->loop->target);
+    size_t length = 0;
+    size_t branch = 0;
+
+    while (index != loop)
+    {
+        const NT_INSTRUCTION *instruction = &jit->module->instructions[index];
+        TRACE_STEP *step = &path[length++];
+        step->index = index;
+        step->taken = false;
+
+        size_t next = index + 1;
+        switch (instruction->opcode)
+        {
+        case BC_RETURN:
+        case BC_RETURN_32:
+        case BC_RETURN_64:
+        case BC_POP_RETURN:
+        case BC_TAIL_CALL:
+        case BC_HALT:
+        case BC_LOOP_TRACE:
+            return 0;
+        case BC_BRANCH:
+            next = instructionIndex(jit, instruction->target);
+            break;
+        case BC_BRANCH_Z_32:
+        case BC_BRANCH_Z_64:
+        case BC_BRANCH_NZ_32:
+        case BC_BRANCH_NZ_64:
+        case BC_EQ_32_BRANCH_Z:
+        case BC_NE_32_BRANCH_Z:
+        case BC_GT_I32_BRANCH_Z:
+        case BC_GT_U32_BRANCH_Z:
+        case BC_LT_I32_BRANCH_Z:
+        case BC_LT_U32_BRANCH_Z:
+        case BC_GE_I32_BRANCH_Z:
+        case BC_GE_U32_BRANCH_Z:
+        case BC_LE_I32_BRANCH_Z:
+        case BC_LE_U32_BRANCH_Z:
+            if (branch == recorder->count)
+                return 0;
+            step->taken = recorder->directions[branch++];
+            if (step->taken)
+                next = instructionIndex(jit, instruction->target);
+            break;
+        default:
+            break;
+        }
+
+        if (next <= index || next > loop)
+            return 0;
+        index = next;
+    }
+
+    return branch == recorder->count ? length : 0;
+}
+
+// leaves the trace where the interpreter resumes, with the stack top written back
+static void emitExit(JIT *jit, const NT_INSTRUCTION *exit)
+{
+    static const uint8_t store[] = {0x49, 0x89, 0x9C, 0x24}; // mov [r12 + disp32], rbx
+    ntArrayAdd(&jit->code, store, sizeof(store));
+    emit32(jit, (uint32_t)offsetof(NT_VM, stackTop));
+    emitOpcode(jit, 0x48B8); // mov rax, imm64
+    emit64(jit, (uint64_t)(uintptr_t)exit);
+    emitEpilogue(jit);
+}
+
+// Charges the fuel of the VM for one more iteration. An empty tank leaves to the interpreter, which
+// stops the run on the loop instruction.
+static void emitCharge(JIT *jit, const size_t exit)
+{
+    static const uint8_t compare[] = {0x49, 0x83, 0xBC, 0x24}; // cmp qword [r12 + disp32], imm8
+    ntArrayAdd(&jit->code, compare, sizeof(compare));
+    emit32(jit, (uint32_t)offsetof(NT_VM, fuel));
+    emit8(jit, 0);
+    emitJump(jit, JCC | CC_E, exit);
+
+    static const uint8_t decrement[] = {0x49, 0xFF, 0x8C, 0x24}; // dec qword [r12 + disp32]
+    ntArrayAdd(&jit->code, decrement, sizeof(decrement));
+    emit32(jit, (uint32_t)offsetof(NT_VM, fuel));
+}
+
+// A VM that stays interpreted leaves the trace before a call, so the callee runs unnested and can
+// stop the run or be sampled.
+static void emitInterpretExit(JIT *jit, const size_t exit)
+{
+    static const uint8_t compare[] = {0x41, 0x80, 0xBC, 0x24}; // cmp byte [r12 + disp32], imm8
+    ntArrayAdd(&jit->code, compare, sizeof(compare));
+    emit32(jit, (uint32_t)offsetof(NT_VM, interpret));
+    emit8(jit, 0);
+    emitJump(jit, JCC | CC_NE, exit);
+}
+
+bool ntJitCompileTrace(const NT_MODULE *module, const NT_TRACE_RECORDER *recorder)
+{
+    assert(module);
+    assert(recorder->loop);
+    assert(recorder->loop->opcode == BC_BRANCH);
+
+    JIT jit = {.module = module};
+    const size_t count = module->instructionCount;
+    TRACE_STEP *path = ntMalloc(sizeof(TRACE_STEP) * count);
+    const size_t length = tracePath(&jit, recorder, path);
+    if (length == 0)
+    {
+        ntFree(path);
+        return false;
+    }
+
+    size_t calls = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        const uint8_t opcode = module->instructions[path[i].index].opcode;
+        calls += opcode == BC_CALL || opcode == BC_CALL_DIRECT;
+    }
+
+    ntInitArray(&jit.code);
+    ntInitArray(&jit.fixups);
+    // labels are instructions, the bail out and then one side exit per guard, per call and the
+    // fuel exit
+    const size_t maxExits = NT_TRACE_BRANCHES + calls + 1;
+    jit.offsets = ntMalloc(sizeof(size_t) * (count + 1 + maxExits));
+    const NT_INSTRUCTION **exits = ntMalloc(sizeof(NT_INSTRUCTION *) * maxExits);
+    size_t exitCount = 0;
+
+    emitPrologue(&jit);
+    bool result = true;
+    for (size_t i = 0; i < length && result; ++i)
+    {
+        const NT_INSTRUCTION *instruction = &module->instructions[path[i].index];
+        jit.offsets[path[i].index] = jit.code.count;
+
+        uint8_t cc;
+        if (instruction->opcode == BC_BRANCH)
+            continue;
+        if (!emitBranchTest(&jit, instruction, &cc))
+        {
+            if (instruction->opcode == BC_CALL || instruction->opcode == BC_CALL_DIRECT)
+            {
+                exits[exitCount] = instruction;
+                emitInterpretExit(&jit, count + 1 + exitCount);
+                ++exitCount;
+            }
+            result = emitInstruction(&jit, instruction);
+            continue;
+        }
+
+        // guard on the recorded direction, the other one leaves the trace
+        exits[exitCount] = path[i].taken ? instruction + 1 : instruction->target;
+        emitJump(&jit, JCC | (path[i].taken ? cc ^ 1 : cc), count + 1 + exitCount);
+        ++exitCount;
+    }
+
+    if (result)
+    {
+        // the fuel exit leaves on the loop instruction, which is the trace entry by then
+        exits[exitCount] = recorder->loop;
+        emitCharge(&jit, count + 1 + exitCount);
+        ++exitCount;
+        emitJump(&jit, JMP, path[0].index);
+        for (size_t i = 0; i < exitCount; ++i)
+        {
+            jit.offsets[count + 1 + i] = jit.code.count;
+            emitExit(&jit, exits[i]);
+        }
+        emitBail(&jit);
+        resolveFixups(&jit);
+
+        void *code = install(&jit.code, recorder->loop->target);
+        result = code != NULL;
+        if (result)
+        {
+            NT_INSTRUCTION *loop = &module->instructions[instructionIndex(&jit, recorder->loop)];
+            loop->value64 = (uint64_t)(uintptr_t)code;
+            loop->opcode = BC_LOOP_TRACE;
+        }
+    }
+
+    ntFree(exits);
+    ntFree(path);
+    ntFree(jit.offsets);
+    ntDeinitArray(&jit.fixups);
+    ntDeinitArray(&jit.code);
+    return result;
+}
+
+const NT_INSTRUCTION *ntJitEnterTrace(NT_VM *vm, const NT_INSTRUCTION *instruction)
+{
+    assert(instruction->opcode == BC_LOOP_TRACE);
+
+    JIT_TRACE trace;
+    const void *code = (const void *)(uintptr_t)instruction->value64;
+    memcpy(&trace, &code, sizeof(JIT_TRACE));
+    return trace(vm, vm->stackTop);
+}
+
+const NT_INSTRUCTION *ntJitTraceHeader(const NT_INSTRUCTION *instruction)
+{
+    return traceHeader(instruction);
+}
+
+void ntJitFreeTraces(NT_MODULE *module)
+{
+    for (size_t i = 0; i < module->instructionCount; ++i)
+    {
+        if (module->instructions[i].opcode == BC_LOOP_TRACE)
+            release((void *)(uintptr_t)module->instructions[i].value64);
+    }
+}
+
+#endif
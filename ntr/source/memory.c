@@ -37,8 +37,11 @@ typedef struct
 } Mem;
 #endif
 
+static _Thread_local uint64_t allocations = 0;
+
 void *ntMalloc(size_t size)
 {
+    ++allocations;
 #ifdef DEBUG_MEM
     Mem *mem = (Mem *)malloc(sizeof(Mem) + size);
     mem->size = size;
@@ -85,10 +88,16 @@ void *ntRealloc(void *old, size_t size)
     else
         return ntMalloc(size);
 #else
+    ++allocations;
     return realloc(old, size);
 #endif
 }
 
+uint64_t ntAllocations(void)
+{
+    return allocations;
+}
+
 void ntMemcpy(void *dst, const void *src, size_t size)
 {
 #ifdef DEBUG_MEM
@@ -23,6 +23,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include <assert.h>
+#include <netuno/jit.h>
 #include <netuno/memory.h>
 #include <netuno/module.h>
 #include <netuno/object.h>
@@ -55,6 +56,12 @@ static void freeModule(NT_OBJECT *object)
     ntDeinitArray(&module->code);
     ntDeinitArray(&module->lines);
     ntDeinitArray(&module->constants);
+#ifdef NT_JIT
+    if (module->instructions)
+        ntJitFreeTraces(module);
+#endif
+    ntFree(module->instructions);
+    ntFree(module->instructionPcs);
 }
 
 static const NT_STRING *moduleToString(NT_OBJECT *object)
@@ -126,7 +133,7 @@ void ntInitModule(NT_MODULE *module)
     if (module->type.object.type != type)
     {
         module->type.object.type = type;
-        module->type.object.refCount = 1;
+        atomic_init(&module->type.object.refCount, 1);
     }
 
     module->type.objectType = NT_OBJECT_MODULE;
@@ -142,6 +149,10 @@ void ntInitModule(NT_MODULE *module)
     ntInitArray(&module->code);
     ntInitArray(&module->lines);
     ntInitArray(&module->constants);
+
+    module->instructions = NULL;
+    module->instructionPcs = NULL;
+    module->instructionCount = 0;
 }
 
 static void addLine(NT_MODULE *module, const size_t length, const size_t line)
@@ -190,33 +190,46 @@ NT_OBJECT *ntCreateObject(const NT_TYPE *type)
 {
     NT_OBJECT *object = (NT_OBJECT *)ntMalloc(type->instanceSize);
     object->type = type;
-    object->refCount = 1;
+    atomic_init(&object->refCount, 1);
     return object;
 }
 
 void ntRefObject(NT_OBJECT *object)
 {
-    if (object->refCount)
-        object->refCount++;
+    // only a holder of a reference takes another, so a nonzero count stays nonzero
+    const size_t count = atomic_load_explicit(&object->refCount, memory_order_relaxed);
+    if (count == 0)
+        return;
+    if (object->type->objectType == NT_OBJECT_STRING)
+        atomic_fetch_add_explicit(&object->refCount, 1, memory_order_relaxed);
+    else
+        atomic_store_explicit(&object->refCount, count + 1, memory_order_relaxed);
 }
 
 void ntFreeObject(NT_OBJECT *object)
 {
     assert(object);
     // refCount == 0 for constant objects
-    if (object->refCount > 0)
+    const size_t count = atomic_load_explicit(&object->refCount, memory_order_relaxed);
+    if (count == 0)
+        return;
+
+    // the intern table may hand the string out again until its last reference is gone
+    if (object->type->objectType == NT_OBJECT_STRING)
     {
-        object->refCount--;
-        if (object->refCount <= 0)
-        {
-            ntForceFreeObject(object);
-        }
+        ntReleaseString((const NT_STRING *)object);
+        return;
     }
+
+    if (count == 1)
+        ntForceFreeObject(object);
+    else
+        atomic_store_explicit(&object->refCount, count - 1, memory_order_relaxed);
 }
 
 void ntMakeConstant(NT_OBJECT *object)
 {
-    object->refCount = 0;
+    atomic_store_explicit(&object->refCount, 0, memory_order_relaxed);
 }
 
 static void freeBase(NT_OBJECT *object, const NT_TYPE *current)
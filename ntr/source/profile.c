@@ -0,0 +1,299 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <netuno/delegate.h>
+#include <netuno/instruction.h>
+#include <netuno/memory.h>
+#include <netuno/module.h>
+#include <netuno/profile.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#define NT_PROFILER
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+// frames all samples of a profile hold together
+#define PROFILE_FRAMES (1 << 20)
+
+struct _NT_PROFILE
+{
+    NT_VM *vm;
+    // the frames of every sample one after the other, innermost first
+    NT_FRAME *frames;
+    size_t frameCount;
+    uint8_t depths[NT_PROFILE_SAMPLES];
+    size_t sampleCount;
+    size_t lost;
+    bool running;
+#ifdef NT_PROFILER
+    timer_t timer;
+#endif
+};
+
+#ifdef NT_PROFILER
+static pthread_once_t handlerOnce = PTHREAD_ONCE_INIT;
+
+// runs on the thread of the VM, which it interrupted, and only writes the profile
+static void sample(int signal, siginfo_t *info, void *context)
+{
+    (void)signal;
+    (void)context;
+    NT_PROFILE *profile = (NT_PROFILE *)info->si_value.sival_ptr;
+    // SIGPROF from anything other than a profile timer
+    if (info->si_code != SI_TIMER || profile == NULL)
+        return;
+
+    if (profile->sampleCount == NT_PROFILE_SAMPLES ||
+        profile->frameCount > PROFILE_FRAMES - NT_PROFILE_DEPTH)
+    {
+        ++profile->lost;
+        return;
+    }
+
+    const size_t depth =
+        ntBacktrace(profile->vm, profile->frames + profile->frameCount, NT_PROFILE_DEPTH);
+    // dropped midway through a call, a return or a fiber switch rather than kept truncated
+    if (depth == 0)
+    {
+        ++profile->lost;
+        return;
+    }
+    profile->depths[profile->sampleCount++] = (uint8_t)depth;
+    profile->frameCount += depth;
+}
+
+// the handler stays for good, ticks of stopped profiles are drained before they are freed
+static void installHandler(void)
+{
+    struct sigaction action = {
+        .sa_sigaction = sample,
+        .sa_flags = SA_SIGINFO | SA_RESTART,
+    };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+}
+#endif
+
+NT_PROFILE *ntStartProfile(NT_VM *vm, uint32_t interval)
+{
+    assert(vm);
+    assert(interval > 0);
+#ifdef NT_PROFILER
+    pthread_once(&handlerOnce, installHandler);
+
+    NT_PROFILE *profile = (NT_PROFILE *)ntMalloc(sizeof(NT_PROFILE));
+    profile->vm = vm;
+    profile->frames = (NT_FRAME *)ntMalloc(sizeof(NT_FRAME) * PROFILE_FRAMES);
+    profile->frameCount = 0;
+    profile->sampleCount = 0;
+    profile->lost = 0;
+    profile->running = false;
+
+    struct sigevent event = {
+        .sigev_notify = SIGEV_THREAD_ID,
+        .sigev_signo = SIGPROF,
+        .sigev_value.sival_ptr = profile,
+    };
+    event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &profile->timer) != 0)
+    {
+        ntFreeProfile(profile);
+        return NULL;
+    }
+
+    const struct timespec period = {
+        .tv_sec = interval / 1000000,
+        .tv_nsec = (long)(interval % 1000000) * 1000,
+    };
+    const struct itimerspec spec = {.it_interval = period, .it_value = period};
+    profile->running = true;
+    vm->interpret |= NT_INTERPRET_PROFILE;
+    if (timer_settime(profile->timer, 0, &spec, NULL) != 0)
+    {
+        ntFreeProfile(profile);
+        return NULL;
+    }
+    return profile;
+#else
+    (void)vm;
+    (void)interval;
+    return NULL;
+#endif
+}
+
+void ntStopProfile(NT_PROFILE *profile)
+{
+    assert(profile);
+    if (!profile->running)
+        return;
+    profile->running = false;
+    profile->vm->interpret &= ~NT_INTERPRET_PROFILE;
+#ifdef NT_PROFILER
+    timer_delete(profile->timer);
+
+    // a tick may still be pending, it must not land once the profile is freed
+    sigset_t set;
+    sigset_t previous;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, &previous);
+    const struct timespec zero = {0};
+    while (sigtimedwait(&set, NULL, &zero) > 0)
+        ;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+#endif
+}
+
+void ntFreeProfile(NT_PROFILE *profile)
+{
+    if (!profile)
+        return;
+    ntStopProfile(profile);
+    ntFree(profile->frames);
+    ntFree(profile);
+}
+
+static void addString(NT_ARRAY *line, const NT_STRING *string)
+{
+    char *chars = ntToCharFixed(string->chars, string->length);
+    ntArrayAdd(line, chars, strlen(chars));
+    ntFree(chars);
+}
+
+// the function of the module whose code starts closest before the instruction
+static const NT_DELEGATE *findFunction(const NT_MODULE *module, const NT_INSTRUCTION *instruction)
+{
+    const NT_DELEGATE *function = NULL;
+    const NT_ARRAY *symbols = module->type.fields.table;
+    for (size_t i = 0; i < symbols->count / sizeof(NT_SYMBOL_ENTRY); ++i)
+    {
+        const NT_SYMBOL_ENTRY *entry = &((const NT_SYMBOL_ENTRY *)symbols->data)[i];
+        if ((entry->type & (SYMBOL_TYPE_FUNCTION | SYMBOL_TYPE_SUBROUTINE)) == 0)
+            continue;
+
+        const NT_DELEGATE *delegate = (const NT_DELEGATE *)entry->data;
+        if (delegate == NULL || delegate->native || delegate->sourceModule != module ||
+            delegate->entry == NULL || delegate->entry > instruction)
+            continue;
+        if (function == NULL || delegate->entry > function->entry)
+            function = delegate;
+    }
+    return function;
+}
+
+// Appends "module.function:line" for a frame. False for the frames of the host, whose pc is in
+// no module of the program.
+static bool addFrame(NT_ARRAY *line, const NT_FRAME *frame)
+{
+    const NT_MODULE *module = frame->module;
+    if (module == NULL || module->type.typeName == NULL || frame->pc <= module->instructions ||
+        frame->pc > module->instructions + module->instructionCount)
+        return false;
+
+    const NT_INSTRUCTION *instruction = frame->pc - 1;
+    if (line->count)
+        ntArrayAdd(line, ";", 1);
+    addString(line, module->type.typeName);
+    ntArrayAdd(line, ".", 1);
+
+    const NT_DELEGATE *function = findFunction(module, instruction);
+    if (function && function->name)
+        addString(line, function->name);
+    else
+        ntArrayAdd(line, "?", 1);
+
+    bool atStart;
+    const int64_t number = ntGetLine(module, ntInstructionPc(module, instruction), &atStart);
+    char text[24];
+    const int length = snprintf(text, sizeof(text), ":%" PRId64, number + 1);
+    ntArrayAdd(line, text, (size_t)length);
+    return true;
+}
+
+static int compareLines(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+bool ntWriteProfile(const NT_PROFILE *profile, FILE *file)
+{
+    assert(profile);
+    assert(file);
+
+    char **lines = (char **)ntMalloc(sizeof(char *) * (profile->sampleCount + 1));
+    size_t count = 0;
+    const NT_FRAME *frames = profile->frames;
+    for (size_t i = 0; i < profile->sampleCount; ++i)
+    {
+        const size_t depth = profile->depths[i];
+        NT_ARRAY line;
+        ntInitArray(&line);
+        // collapsed stacks start at the root
+        for (size_t j = depth; j > 0; --j)
+            addFrame(&line, &frames[j - 1]);
+        frames += depth;
+
+        if (line.count == 0)
+        {
+            ntDeinitArray(&line);
+            continue;
+        }
+        ntArrayAdd(&line, "", 1);
+        lines[count++] = (char *)line.data;
+    }
+
+    // identical stacks become neighbours and are written once with their count
+    qsort(lines, count, sizeof(char *), compareLines);
+    bool result = true;
+    for (size_t i = 0; i < count;)
+    {
+        size_t next = i + 1;
+        while (next < count && strcmp(lines[i], lines[next]) == 0)
+            ++next;
+        result = result && fprintf(file, "%s %zu\n", lines[i], next - i) > 0;
+        i = next;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        ntFree(lines[i]);
+    ntFree(lines);
+    return result;
+}
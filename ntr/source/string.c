@@ -31,12 +31,81 @@ SOFTWARE.
 #include <netuno/type.h>
 #include <stdio.h>
 
-static NT_TABLE stringTable = {.count = 0, .size = 0, .pEntries = NULL};
+#ifdef _WIN32
+#include <windows.h>
+#define YIELD() SwitchToThread()
+#else
+#include <sched.h>
+#define YIELD() sched_yield()
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#elif defined(__aarch64__)
+#define CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
+// Interned strings spread over shards by the top bits of their hash, each with its own lock, so
+// threads creating strings rarely wait on each other.
+#define STRING_SHARD_BITS 6
+#define STRING_SHARDS (1 << STRING_SHARD_BITS)
+// spins on a taken shard before giving up the CPU, a holder may have been preempted
+#define SHARD_SPINS 64
+
+typedef struct
+{
+    atomic_bool locked;
+    NT_TABLE table;
+} STRING_SHARD;
+
+static STRING_SHARD stringShards[STRING_SHARDS];
+
+static STRING_SHARD *lockShard(const uint32_t hash)
+{
+    STRING_SHARD *shard = &stringShards[hash >> (32 - STRING_SHARD_BITS)];
+    while (atomic_exchange_explicit(&shard->locked, true, memory_order_acquire))
+    {
+        for (size_t spins = 0; atomic_load_explicit(&shard->locked, memory_order_relaxed); ++spins)
+        {
+            if (spins < SHARD_SPINS)
+                CPU_RELAX();
+            else
+                YIELD();
+        }
+    }
+    return shard;
+}
+
+static void unlockShard(STRING_SHARD *shard)
+{
+    atomic_store_explicit(&shard->locked, false, memory_order_release);
+}
+
+static void unintern(STRING_SHARD *shard, NT_STRING *string)
+{
+    void *value;
+    if (shard->table.count)
+        ntTableDelete(&shard->table, string, &value);
+    string->interned = false;
+}
 
 static void freeString(NT_OBJECT *object)
 {
     assert(object->type->objectType == NT_OBJECT_STRING);
     NT_STRING *string = (NT_STRING *)object;
+
+    // constants are freed with their assembly without ever dropping a reference, the other
+    // strings left the table with their last one
+    if (string->interned)
+    {
+        STRING_SHARD *shard = lockShard(string->hash);
+        unintern(shard, string);
+        unlockShard(shard);
+    }
+
     ntFree(string->chars);
     string->chars = NULL;
     string->length = 0;
@@ -60,8 +129,7 @@ static bool stringEquals(NT_OBJECT *_str1, NT_OBJECT *_str2)
         return false;
     if (str1->length != str2->length)
         return false;
-    return ntStrEqualsFixed(str1->chars, str1->length * sizeof(char_t), str2->chars,
-                            str2->length * sizeof(char_t));
+    return ntStrEqualsFixed(str1->chars, str1->length, str2->chars, str2->length);
 }
 
 static NT_TYPE STRING_TYPE = {
@@ -91,13 +159,25 @@ const NT_TYPE *ntStringType(void)
     return &STRING_TYPE;
 }
 
-static NT_STRING *allocString(char_t *chars, const size_t length, const uint32_t hash)
+// takes a reference to an interned string, constants stay at zero
+static const NT_STRING *findString(STRING_SHARD *shard, const char_t *chars, const size_t length,
+                                   const uint32_t hash)
+{
+    const NT_STRING *interned = ntTableFindString(&shard->table, chars, length, hash);
+    if (interned)
+        ntRefObject((NT_OBJECT *)interned);
+    return interned;
+}
+
+static NT_STRING *allocString(STRING_SHARD *shard, char_t *chars, const size_t length,
+                              const uint32_t hash)
 {
     NT_STRING *string = (NT_STRING *)ntCreateObject(&STRING_TYPE);
     string->chars = chars;
     string->length = length;
     string->hash = hash;
-    ntTableSet(&stringTable, string, NULL);
+    string->interned = true;
+    ntTableSet(&shard->table, string, NULL);
     return string;
 }
 
@@ -115,29 +195,69 @@ static uint32_t hashString(const char_t *chars, const size_t length)
 const NT_STRING *ntCopyString(const char_t *chars, const size_t length)
 {
     const uint32_t hash = hashString(chars, length);
+    STRING_SHARD *shard = lockShard(hash);
 
-    const NT_STRING *interned = ntTableFindString(&stringTable, chars, length, hash);
+    const NT_STRING *interned = findString(shard, chars, length, hash);
     if (interned != NULL)
+    {
+        unlockShard(shard);
         return interned;
+    }
 
     char_t *copyChars = (char_t *)ntMalloc((length + 1) * sizeof(char_t));
     ntMemcpy(copyChars, chars, length * sizeof(char_t));
     copyChars[length] = '\0';
 
-    return allocString(copyChars, length, hash);
+    const NT_STRING *string = allocString(shard, copyChars, length, hash);
+    unlockShard(shard);
+    return string;
 }
 
 const NT_STRING *ntTakeString(char_t *chars, const size_t length)
 {
-    uint32_t hash = hashString(chars, length);
-    const NT_STRING *interned = ntTableFindString(&stringTable, chars, length, hash);
+    const uint32_t hash = hashString(chars, length);
+    STRING_SHARD *shard = lockShard(hash);
+
+    const NT_STRING *interned = findString(shard, chars, length, hash);
     if (interned != NULL)
     {
+        unlockShard(shard);
         ntFree(chars);
         return interned;
     }
 
-    return allocString(chars, length, hash);
+    const NT_STRING *string = allocString(shard, chars, length, hash);
+    unlockShard(shard);
+    return string;
+}
+
+void ntReleaseString(const NT_STRING *string)
+{
+    NT_OBJECT *object = (NT_OBJECT *)string;
+
+    // references above the last one drop without the lock
+    size_t count = atomic_load_explicit(&object->refCount, memory_order_relaxed);
+    while (count > 1)
+    {
+        if (atomic_compare_exchange_weak_explicit(&object->refCount, &count, count - 1,
+                                                  memory_order_acq_rel, memory_order_relaxed))
+            return;
+    }
+    if (count == 0)
+        return;
+
+    STRING_SHARD *shard = lockShard(string->hash);
+    // a lookup may have taken a reference since
+    if (atomic_fetch_sub_explicit(&object->refCount, 1, memory_order_acq_rel) != 1)
+    {
+        unlockShard(shard);
+        return;
+    }
+    // freeString leaves the shard alone then
+    unintern(shard, (NT_STRING *)string);
+    unlockShard(shard);
+
+    ntForceFreeObject(object);
 }
 
 const NT_STRING *ntConcat(NT_OBJECT *object1, NT_OBJECT *object2)
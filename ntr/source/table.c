@@ -199,7 +199,7 @@ const NT_STRING *ntTableFindString(const NT_TABLE *table, const char_t *chars, s
                 return NULL;
         }
         else if (entry->key->length == length && entry->key->hash == hash &&
-                 memcmp(entry->key->chars, chars, length) == 0)
+                 memcmp(entry->key->chars, chars, length * sizeof(char_t)) == 0)
             return entry->key; // found it
 
         index = (index + 1) % table->size;
@@ -0,0 +1,472 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/assembly.h>
+#include <netuno/debug.h>
+#include <netuno/handle.h>
+#include <netuno/memory.h>
+#include <netuno/native.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <netuno/task.h>
+#include <netuno/vm.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#define NT_TASK_THREADS
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+typedef enum
+{
+    TASK_PENDING,
+    TASK_DONE,
+    TASK_FAILED,
+} TASK_STATE;
+
+typedef struct
+{
+    NT_ASSEMBLY *assembly;
+    const NT_DELEGATE *delegate;
+    uint32_t arg;
+    uint32_t result;
+    atomic_int state;
+#ifdef NT_OPCODE_COUNTS
+    // what the run counted, for the VM that joins the task
+    NT_OPCODE_PROFILE *counts;
+#endif
+} TASK;
+
+static NT_MODULE TASK_MODULE = {
+    .type.object =
+        {
+            .type = NULL,
+        },
+};
+
+static const NT_DELEGATE_TYPE *TaskSpawnType = NULL;
+
+// VMs of the thread running tasks, reused by every task it runs
+static _Thread_local NT_VM_POOL *pool = NULL;
+
+// tasks nobody joined yet, scripts only see their handles
+static NT_HANDLES handles = {.slots = NULL, .count = 0, .capacity = 0, .firstFree = NT_NO_SLOT};
+
+#ifdef NT_TASK_THREADS
+static pthread_mutex_t handlesLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_HANDLES() pthread_mutex_lock(&handlesLock)
+#define UNLOCK_HANDLES() pthread_mutex_unlock(&handlesLock)
+#else
+#define LOCK_HANDLES()
+#define UNLOCK_HANDLES()
+#endif
+
+static uint64_t addHandle(TASK *task)
+{
+    LOCK_HANDLES();
+    const uint64_t handle = ntAddHandle(&handles, task);
+    UNLOCK_HANDLES();
+    return handle;
+}
+
+// the task of a live handle, which no other join can take afterwards, NULL for any other value
+static TASK *takeHandle(const uint64_t handle)
+{
+    LOCK_HANDLES();
+    TASK *task = (TASK *)ntTakeHandle(&handles, handle);
+    UNLOCK_HANDLES();
+    return task;
+}
+
+// frees the tasks nobody joined, their workers must be gone
+static void freeHandles(void)
+{
+    LOCK_HANDLES();
+    for (uint32_t i = 0; i < handles.count; ++i)
+    {
+        TASK *task = (TASK *)handles.slots[i].data;
+#ifdef NT_OPCODE_COUNTS
+        if (task)
+            ntFree(task->counts);
+#endif
+        ntFree(task);
+    }
+    ntDeinitHandles(&handles);
+    UNLOCK_HANDLES();
+}
+
+static void runTask(TASK *task)
+{
+    if (!pool)
+        pool = ntCreateVMPool(NULL, 1);
+
+    NT_VM *vm = ntAcquireVM(pool);
+    const bool result = ntPush32(vm, task->arg) &&
+                        ntRun(vm, task->assembly, task->delegate) == NT_OK &&
+                        ntPop32(vm, &task->result);
+#ifdef NT_OPCODE_COUNTS
+    // the pooled VM starts over, so each dump covers one program instead of a worker
+    task->counts = vm->counts;
+    vm->counts = ntCreateOpcodeCounts();
+#endif
+    ntReleaseVM(pool, vm);
+
+    atomic_store_explicit(&task->state, result ? TASK_DONE : TASK_FAILED, memory_order_release);
+}
+
+#ifdef NT_TASK_THREADS
+// The owner pushes and pops at the tail, thieves take the oldest task at the head.
+typedef struct
+{
+    pthread_mutex_t lock;
+    TASK **tasks;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+} DEQUE;
+
+typedef struct
+{
+    size_t workerCount;
+    pthread_t *workers;
+    // one per worker, the last one for threads outside the pool
+    DEQUE *deques;
+    atomic_size_t queued;
+    atomic_bool stopping;
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wake;
+} SCHEDULER;
+
+static SCHEDULER scheduler;
+// guards starting and stopping the scheduler, which can start again after ntStopTasks
+static pthread_mutex_t schedulerLock = PTHREAD_MUTEX_INITIALIZER;
+static bool schedulerStarted = false;
+static _Thread_local size_t workerIndex = SIZE_MAX;
+
+static size_t currentDeque(void)
+{
+    return workerIndex == SIZE_MAX ? scheduler.workerCount : workerIndex;
+}
+
+static void pushTask(DEQUE *deque, TASK *task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity)
+    {
+        const size_t count = deque->tail - deque->head;
+        if (deque->head > deque->capacity / 2)
+            memmove(deque->tasks, deque->tasks + deque->head, count * sizeof(TASK *));
+        else
+        {
+            deque->capacity = deque->capacity ? deque->capacity * 2 : 64;
+            TASK **tasks = ntMalloc(deque->capacity * sizeof(TASK *));
+            memcpy(tasks, deque->tasks + deque->head, count * sizeof(TASK *));
+            ntFree(deque->tasks);
+            deque->tasks = tasks;
+        }
+        deque->head = 0;
+        deque->tail = count;
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+
+    atomic_fetch_add_explicit(&scheduler.queued, 1, memory_order_release);
+    pthread_mutex_lock(&scheduler.sleepLock);
+    pthread_cond_signal(&scheduler.wake);
+    pthread_mutex_unlock(&scheduler.sleepLock);
+}
+
+static TASK *takeTask(DEQUE *deque, const bool steal)
+{
+    TASK *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head != deque->tail)
+        task = steal ? deque->tasks[deque->head++] : deque->tasks[--deque->tail];
+    pthread_mutex_unlock(&deque->lock);
+
+    if (task)
+        atomic_fetch_sub_explicit(&scheduler.queued, 1, memory_order_relaxed);
+    return task;
+}
+
+// the newest task of its own deque keeps a thread on the data it just touched
+static TASK *findTask(const size_t self)
+{
+    TASK *task = takeTask(&scheduler.deques[self], false);
+    for (size_t i = 1; !task && i <= scheduler.workerCount; ++i)
+        task = takeTask(&scheduler.deques[(self + i) % (scheduler.workerCount + 1)], true);
+    return task;
+}
+
+static bool stopping(void)
+{
+    return atomic_load_explicit(&scheduler.stopping, memory_order_acquire);
+}
+
+static void *worker(void *data)
+{
+    workerIndex = (size_t)(uintptr_t)data;
+    while (!stopping())
+    {
+        TASK *task = findTask(workerIndex);
+        if (task)
+        {
+            runTask(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler.sleepLock);
+        while (atomic_load_explicit(&scheduler.queued, memory_order_acquire) == 0 && !stopping())
+            pthread_cond_wait(&scheduler.wake, &scheduler.sleepLock);
+        pthread_mutex_unlock(&scheduler.sleepLock);
+    }
+
+    if (pool)
+        ntFreeVMPool(pool);
+    pool = NULL;
+    return NULL;
+}
+
+static void startScheduler(void)
+{
+    pthread_mutex_lock(&schedulerLock);
+    if (schedulerStarted)
+    {
+        pthread_mutex_unlock(&schedulerLock);
+        return;
+    }
+
+    const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    scheduler.workerCount = processors > 0 ? (size_t)processors : 1;
+    scheduler.deques = ntMalloc((scheduler.workerCount + 1) * sizeof(DEQUE));
+    for (size_t i = 0; i <= scheduler.workerCount; ++i)
+    {
+        pthread_mutex_init(&scheduler.deques[i].lock, NULL);
+        scheduler.deques[i].tasks = NULL;
+        scheduler.deques[i].head = 0;
+        scheduler.deques[i].tail = 0;
+        scheduler.deques[i].capacity = 0;
+    }
+    atomic_init(&scheduler.queued, 0);
+    atomic_init(&scheduler.stopping, false);
+    pthread_mutex_init(&scheduler.sleepLock, NULL);
+    pthread_cond_init(&scheduler.wake, NULL);
+
+    // the workers live until ntStopTasks, idle ones sleep
+    scheduler.workers = ntMalloc(scheduler.workerCount * sizeof(pthread_t));
+    for (size_t i = 0; i < scheduler.workerCount; ++i)
+        pthread_create(&scheduler.workers[i], NULL, worker, (void *)(uintptr_t)i);
+
+    schedulerStarted = true;
+    pthread_mutex_unlock(&schedulerLock);
+}
+
+static void stopScheduler(void)
+{
+    pthread_mutex_lock(&schedulerLock);
+    if (!schedulerStarted)
+    {
+        pthread_mutex_unlock(&schedulerLock);
+        return;
+    }
+
+    pthread_mutex_lock(&scheduler.sleepLock);
+    atomic_store_explicit(&scheduler.stopping, true, memory_order_release);
+    pthread_cond_broadcast(&scheduler.wake);
+    pthread_mutex_unlock(&scheduler.sleepLock);
+
+    // a worker finishes the task it runs, queued ones stay in the handle table
+    for (size_t i = 0; i < scheduler.workerCount; ++i)
+        pthread_join(scheduler.workers[i], NULL);
+    ntFree(scheduler.workers);
+
+    for (size_t i = 0; i <= scheduler.workerCount; ++i)
+    {
+        pthread_mutex_destroy(&scheduler.deques[i].lock);
+        ntFree(scheduler.deques[i].tasks);
+    }
+    ntFree(scheduler.deques);
+    pthread_mutex_destroy(&scheduler.sleepLock);
+    pthread_cond_destroy(&scheduler.wake);
+
+    schedulerStarted = false;
+    pthread_mutex_unlock(&schedulerLock);
+}
+#endif
+
+void ntStopTasks(void)
+{
+#ifdef NT_TASK_THREADS
+    stopScheduler();
+#endif
+    freeHandles();
+    // join may have run tasks on this thread
+    if (pool)
+        ntFreeVMPool(pool);
+    pool = NULL;
+}
+
+bool ntAssemblySpawns(const NT_ASSEMBLY *assembly)
+{
+    ntTaskModule();
+    for (size_t i = 0; i < assembly->objects->count / sizeof(NT_REF); ++i)
+    {
+        const NT_OBJECT *object = ntGetConstantObject(assembly, i);
+        if (object->type == (const NT_TYPE *)TaskSpawnType)
+            return true;
+    }
+    return false;
+}
+
+static bool taskSpawn(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == TaskSpawnType);
+
+    uint32_t arg;
+    NT_OBJECT *object;
+    if (!ntPop32(vm, &arg) || !ntPopRef(vm, (NT_REF *)&object))
+        return false;
+
+    // the parameter is an object, so the signature is only known now
+    if (object->type->objectType != NT_OBJECT_DELEGATE)
+        return false;
+    const NT_DELEGATE_TYPE *type = (const NT_DELEGATE_TYPE *)object->type;
+    if (type->paramCount != 1 || type->params[0].type != ntI32Type() ||
+        type->returnType != ntI32Type())
+        return false;
+
+    // other threads are about to run the assembly, which must not change under them
+    if (!vm->assembly->frozen)
+    {
+        fprintf(stderr, "task.spawn needs a frozen assembly, see ntFreezeAssembly\n");
+        return false;
+    }
+
+    TASK *task = (TASK *)ntMalloc(sizeof(TASK));
+    task->assembly = vm->assembly;
+    task->delegate = (const NT_DELEGATE *)object;
+    task->arg = arg;
+    task->result = 0;
+    atomic_init(&task->state, TASK_PENDING);
+#ifdef NT_OPCODE_COUNTS
+    task->counts = NULL;
+#endif
+
+    const uint64_t handle = addHandle(task);
+#ifdef NT_TASK_THREADS
+    startScheduler();
+    pushTask(&scheduler.deques[currentDeque()], task);
+#else
+    runTask(task);
+#endif
+    return ntPush64(vm, handle);
+}
+
+static void addSpawn(void)
+{
+    const NT_PARAM params[] = {
+        {
+            .type = ntObjectType(),
+            .name = ntCopyString(U"function", 8),
+        },
+        {
+            .type = ntI32Type(),
+            .name = ntCopyString(U"arg", 3),
+        },
+    };
+
+    TaskSpawnType = ntCreateNativeFunction(&TASK_MODULE, U"spawn", ntI64Type(), 2, params,
+                                           taskSpawn, true);
+}
+
+static const NT_DELEGATE_TYPE *TaskJoinType = NULL;
+static bool taskJoin(NT_VM *vm, const NT_DELEGATE_TYPE *delegateType)
+{
+    assert(vm);
+    assert(delegateType == TaskJoinType);
+
+    uint64_t handle;
+    if (!ntPop64(vm, &handle))
+        return false;
+    // joined already, or never spawned
+    TASK *task = takeHandle(handle);
+    if (!task)
+        return false;
+
+#ifdef NT_TASK_THREADS
+    // waiting helps, so a join inside a task never blocks the worker it runs on
+    while (atomic_load_explicit(&task->state, memory_order_acquire) == TASK_PENDING)
+    {
+        TASK *other = findTask(currentDeque());
+        if (other)
+            runTask(other);
+        else
+            sched_yield();
+    }
+#endif
+
+    const bool result = atomic_load_explicit(&task->state, memory_order_acquire) == TASK_DONE;
+    const uint32_t value = task->result;
+#ifdef NT_OPCODE_COUNTS
+    ntMergeOpcodeCounts(vm->counts, task->counts);
+    ntFree(task->counts);
+#endif
+    ntFree(task);
+    return result && ntPush32(vm, value);
+}
+
+static void addJoin(void)
+{
+    const NT_PARAM param = {
+        .type = ntI64Type(),
+        .name = ntCopyString(U"handle", 6),
+    };
+
+    TaskJoinType =
+        ntCreateNativeFunction(&TASK_MODULE, U"join", ntI32Type(), 1, &param, taskJoin, true);
+}
+
+const NT_MODULE *ntTaskModule(void)
+{
+    if (TASK_MODULE.type.object.type == NULL)
+    {
+        ntInitModule(&TASK_MODULE);
+        ntMakeConstant((NT_OBJECT *)&TASK_MODULE);
+        const char_t *moduleName = U"task";
+        TASK_MODULE.type.typeName = ntCopyString(moduleName, ntStrLen(moduleName));
+        ntInitSymbolTable(&TASK_MODULE.type.fields, (NT_SYMBOL_TABLE *)&ntType()->fields,
+                          STT_TYPE, NULL);
+
+        addSpawn();
+        addJoin();
+    }
+
+    return &TASK_MODULE;
+}
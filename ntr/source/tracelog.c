@@ -0,0 +1,154 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/instruction.h>
+#include <netuno/memory.h>
+#include <netuno/module.h>
+#include <netuno/str.h>
+#include <netuno/string.h>
+#include <netuno/tracelog.h>
+#include <string.h>
+
+// the first bytes of a file written by ntWriteTraceLog
+static const char MAGIC[8] = "NTLOG001";
+
+NT_TRACE_LOG *ntCreateTraceLog(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size *= 2;
+
+    NT_TRACE_LOG *log = (NT_TRACE_LOG *)ntMalloc(sizeof(NT_TRACE_LOG));
+    atomic_init(&log->head, 0);
+    log->mask = size - 1;
+    log->entries = (NT_TRACE_ENTRY *)ntMalloc(sizeof(NT_TRACE_ENTRY) * size);
+    return log;
+}
+
+void ntFreeTraceLog(NT_TRACE_LOG *log)
+{
+    if (!log)
+        return;
+    ntFree(log->entries);
+    ntFree(log);
+}
+
+void ntSetTraceLog(NT_VM *vm, NT_TRACE_LOG *log)
+{
+    vm->traceLog = log;
+    if (log)
+        vm->interpret |= NT_INTERPRET_LOG;
+    else
+        vm->interpret &= ~NT_INTERPRET_LOG;
+}
+
+size_t ntReadTraceLog(const NT_TRACE_LOG *log, NT_TRACE_ENTRY *entries, size_t count)
+{
+    const size_t capacity = log->mask + 1;
+    const uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+    if (count > head)
+        count = (size_t)head;
+    if (count > capacity)
+        count = capacity;
+
+    const uint64_t first = head - count;
+    for (size_t i = 0; i < count; ++i)
+        entries[i] = log->entries[(first + i) & log->mask];
+
+    // the writer may have wrapped meanwhile, the entry it is writing included
+    atomic_thread_fence(memory_order_acquire);
+    const uint64_t now = atomic_load_explicit(&log->head, memory_order_relaxed);
+    const uint64_t oldest = now >= capacity ? now - capacity + 1 : 0;
+    if (first >= oldest)
+        return count;
+    if (oldest >= head)
+        return 0;
+    const size_t lost = (size_t)(oldest - first);
+    memmove(entries, entries + lost, sizeof(NT_TRACE_ENTRY) * (count - lost));
+    return count - lost;
+}
+
+static bool writeU32(FILE *file, uint32_t value)
+{
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+bool ntWriteTraceLog(const NT_TRACE_LOG *log, FILE *file)
+{
+    const size_t capacity = log->mask + 1;
+    NT_TRACE_ENTRY *entries = (NT_TRACE_ENTRY *)ntMalloc(sizeof(NT_TRACE_ENTRY) * capacity);
+    const size_t count = ntReadTraceLog(log, entries, capacity);
+
+    // the modules are written once, by name, and the entries refer to them by index
+    NT_ARRAY modules;
+    ntInitArray(&modules);
+    uint32_t *moduleIndexes = (uint32_t *)ntMalloc(sizeof(uint32_t) * (count + 1));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const NT_MODULE *module = entries[i].module;
+        const size_t known = modules.count / sizeof(NT_MODULE *);
+        size_t index = 0;
+        while (index < known && ((const NT_MODULE **)modules.data)[index] != module)
+            ++index;
+        if (index == known)
+            ntArrayAdd(&modules, &module, sizeof(NT_MODULE *));
+        moduleIndexes[i] = (uint32_t)index;
+    }
+
+    const size_t moduleCount = modules.count / sizeof(NT_MODULE *);
+    bool result = fwrite(MAGIC, sizeof(MAGIC), 1, file) == 1 && writeU32(file, moduleCount);
+    for (size_t i = 0; i < moduleCount && result; ++i)
+    {
+        const NT_MODULE *module = ((const NT_MODULE **)modules.data)[i];
+        // the host module has no name
+        char *name = module->type.typeName
+                         ? ntToCharFixed(module->type.typeName->chars,
+                                         module->type.typeName->length)
+                         : NULL;
+        const uint32_t length = name ? (uint32_t)strlen(name) : 0;
+        result = writeU32(file, length) && (length == 0 || fwrite(name, 1, length, file) == length);
+        ntFree(name);
+    }
+
+    uint64_t written = count;
+    result = result && fwrite(&written, sizeof(written), 1, file) == 1;
+    for (size_t i = 0; i < count && result; ++i)
+    {
+        const NT_TRACE_ENTRY *entry = &entries[i];
+        const size_t pc = ntInstructionPc(entry->module, &entry->module->instructions[entry->index]);
+        bool atStart;
+        const int64_t line = entry->module->type.typeName
+                                 ? ntGetLine(entry->module, pc, &atStart) + 1
+                                 : 0;
+        result = writeU32(file, moduleIndexes[i]) && writeU32(file, (uint32_t)pc) &&
+                 writeU32(file, (uint32_t)line) && writeU32(file, entry->depth) &&
+                 writeU32(file, entry->opcode);
+    }
+
+    ntFree(moduleIndexes);
+    ntDeinitArray(&modules);
+    ntFree(entries);
+    return result;
+}
@@ -0,0 +1,367 @@
+/*
+MIT License
+
+Copyright (c) 2022 Ezequias Silva <ezequiasmoises@gmail.com> and the Netuno
+contributors. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <assert.h>
+#include <netuno/delegate.h>
+#include <netuno/instruction.h>
+#include <netuno/memory.h>
+#include <netuno/opcode.h>
+#include <netuno/verifier.h>
+
+// Abstract frame at one instruction. Every 4-byte slot remembers the delegate type of a
+// reference that starts there, so calls through locals and arguments have a known effect.
+typedef struct
+{
+    bool reached;
+    size_t depth;
+    size_t capacity;
+    const NT_DELEGATE_TYPE **types;
+} FRAME_STATE;
+
+typedef struct
+{
+    const NT_INSTRUCTION *instructions;
+    const size_t *indices;
+    size_t begin;
+    size_t end;
+    // states where paths join, indexed from begin
+    FRAME_STATE *joins;
+    bool *targets;
+    FRAME_STATE current;
+    size_t maxDepth;
+    size_t returnSize;
+    bool changed;
+} VERIFIER;
+
+static size_t paramsSize(const NT_DELEGATE_TYPE *delegateType)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < delegateType->paramCount; ++i)
+        size += delegateType->params[i].type->stackSize;
+    return size;
+}
+
+static size_t returnSize(const NT_DELEGATE_TYPE *delegateType)
+{
+    return delegateType->returnType ? delegateType->returnType->stackSize : 0;
+}
+
+static const NT_DELEGATE_TYPE *asDelegateType(const NT_TYPE *type)
+{
+    if (type && type->objectType == NT_OBJECT_DELEGATE)
+        return (const NT_DELEGATE_TYPE *)type;
+    return NULL;
+}
+
+// two delegate types are interchangeable on the stack when their frames have the same size
+static bool sameEffect(const NT_DELEGATE_TYPE *a, const NT_DELEGATE_TYPE *b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b)
+        return false;
+    return paramsSize(a) == paramsSize(b) && returnSize(a) == returnSize(b);
+}
+
+static void resize(FRAME_STATE *state, const size_t depth)
+{
+    const size_t count = depth / sizeof(uint32_t);
+    if (count > state->capacity)
+    {
+        const size_t capacity = count * 2;
+        state->types = (const NT_DELEGATE_TYPE **)ntRealloc(
+            state->types, sizeof(const NT_DELEGATE_TYPE *) * capacity);
+        state->capacity = capacity;
+    }
+    for (size_t i = state->depth / sizeof(uint32_t); i < count; ++i)
+        state->types[i] = NULL;
+    state->depth = depth;
+}
+
+static void copyState(FRAME_STATE *to, const FRAME_STATE *from)
+{
+    to->depth = 0;
+    resize(to, from->depth);
+    for (size_t i = 0; i < from->depth / sizeof(uint32_t); ++i)
+        to->types[i] = from->types[i];
+    to->reached = from->reached;
+}
+
+static bool push(VERIFIER *verifier, const size_t size, const NT_DELEGATE_TYPE *type)
+{
+    if (size % sizeof(uint32_t) != 0)
+        return false;
+
+    FRAME_STATE *current = &verifier->current;
+    const size_t slot = current->depth / sizeof(uint32_t);
+    resize(current, current->depth + size);
+    if (size > 0)
+        current->types[slot] = type;
+
+    if (current->depth > verifier->maxDepth)
+        verifier->maxDepth = current->depth;
+    return true;
+}
+
+static bool pop(VERIFIER *verifier, const size_t size)
+{
+    FRAME_STATE *current = &verifier->current;
+    if (size > current->depth || size % sizeof(uint32_t) != 0)
+        return false;
+    current->depth -= size;
+    return true;
+}
+
+// merges the current state into the one at a join point
+static bool join(VERIFIER *verifier, const size_t index)
+{
+    if (index < verifier->begin || index >= verifier->end)
+        return false;
+
+    FRAME_STATE *state = &verifier->joins[index - verifier->begin];
+    const FRAME_STATE *current = &verifier->current;
+    if (!state->reached)
+    {
+        copyState(state, current);
+        verifier->changed = true;
+        return true;
+    }
+
+    if (state->depth != current->depth)
+        return false;
+
+    for (size_t i = 0; i < state->depth / sizeof(uint32_t); ++i)
+    {
+        if (state->types[i] && !sameEffect(state->types[i], current->types[i]))
+        {
+            state->types[i] = NULL;
+            verifier->changed = true;
+        }
+    }
+    return true;
+}
+
+static bool branch(VERIFIER *verifier, const NT_INSTRUCTION *instruction)
+{
+    return join(verifier, verifier->indices[instruction->value64]);
+}
+
+// applies one instruction to the current state, false when it breaks the stack discipline
+static bool step(VERIFIER *verifier, const NT_INSTRUCTION *instruction)
+{
+    FRAME_STATE *current = &verifier->current;
+    size_t size = sizeof(uint32_t);
+
+    switch (instruction->opcode)
+    {
+    case BC_LOAD_SP_64:
+        size = sizeof(uint64_t);
+        // fall through
+    case BC_LOAD_SP_32: {
+        if (instruction->operand % sizeof(uint32_t) != 0 ||
+            (size_t)instruction->operand + size > current->depth)
+            return false;
+        const size_t source = (current->depth - size - instruction->operand) / sizeof(uint32_t);
+        return push(verifier, size, size == sizeof(NT_REF) ? current->types[source] : NULL);
+    }
+    case BC_STORE_SP_64:
+        size = sizeof(uint64_t);
+        // fall through
+    case BC_STORE_SP_32: {
+        if (instruction->operand % sizeof(uint32_t) != 0 ||
+            (size_t)instruction->operand + size > current->depth)
+            return false;
+        const size_t top = (current->depth - size) / sizeof(uint32_t);
+        const size_t destination = top - instruction->operand / sizeof(uint32_t);
+        if (destination == top)
+            return true;
+
+        // a reference starting one slot lower would be cut in half
+        if (destination > 0)
+            current->types[destination - 1] = NULL;
+        current->types[destination] = size == sizeof(NT_REF) ? current->types[top] : NULL;
+        for (size_t i = 1; i < size / sizeof(uint32_t); ++i)
+            current->types[destination + i] = NULL;
+        return true;
+    }
+    case BC_POP:
+        return pop(verifier, instruction->operand);
+    case BC_CONST_OBJECT:
+        return push(verifier, sizeof(NT_REF), asDelegateType(instruction->object->type));
+    case BC_CALL: {
+        if (current->depth < sizeof(NT_REF))
+            return false;
+        const NT_DELEGATE_TYPE *delegateType =
+            current->types[(current->depth - sizeof(NT_REF)) / sizeof(uint32_t)];
+        if (!delegateType)
+            return false;
+        return pop(verifier, sizeof(NT_REF) + paramsSize(delegateType)) &&
+               push(verifier, returnSize(delegateType), asDelegateType(delegateType->returnType));
+    }
+    case BC_CALL_DIRECT: {
+        const NT_DELEGATE_TYPE *delegateType =
+            (const NT_DELEGATE_TYPE *)instruction->object->type;
+        return pop(verifier, paramsSize(delegateType)) &&
+               push(verifier, returnSize(delegateType), asDelegateType(delegateType->returnType));
+    }
+    case BC_BRANCH:
+        current->reached = false;
+        return branch(verifier, instruction);
+    case BC_BRANCH_Z_32:
+    case BC_BRANCH_NZ_32:
+        return current->depth >= sizeof(uint32_t) && branch(verifier, instruction);
+    case BC_BRANCH_Z_64:
+    case BC_BRANCH_NZ_64:
+        return current->depth >= sizeof(uint64_t) && branch(verifier, instruction);
+    case BC_RETURN:
+        current->reached = false;
+        return current->depth == verifier->returnSize;
+    case BC_TAIL_CALL: {
+        // the callee returns for this function, into the frame its arguments slide down to
+        const NT_DELEGATE *callee = (const NT_DELEGATE *)instruction->object;
+        const NT_DELEGATE_TYPE *delegateType = (const NT_DELEGATE_TYPE *)callee->object.type;
+        current->reached = false;
+        return !callee->native && current->depth == instruction->operand + paramsSize(delegateType) &&
+               returnSize(delegateType) == verifier->returnSize;
+    }
+    default: {
+        size_t pops;
+        size_t pushes;
+        return ntStackEffect(instruction->opcode, &pops, &pushes) && pop(verifier, pops) &&
+               push(verifier, pushes, NULL);
+    }
+    }
+}
+
+static void entryState(VERIFIER *verifier, const NT_DELEGATE_TYPE *delegateType)
+{
+    FRAME_STATE *current = &verifier->current;
+    current->depth = 0;
+    current->reached = true;
+    for (size_t i = 0; i < delegateType->paramCount; ++i)
+    {
+        const NT_TYPE *type = delegateType->params[i].type;
+        push(verifier, type->stackSize, asDelegateType(type));
+    }
+}
+
+static bool verify(VERIFIER *verifier)
+{
+    FRAME_STATE *current = &verifier->current;
+    for (size_t i = verifier->begin; i < verifier->end; ++i)
+    {
+        if (verifier->targets[i - verifier->begin])
+        {
+            if (current->reached && !join(verifier, i))
+                return false;
+
+            const FRAME_STATE *state = &verifier->joins[i - verifier->begin];
+            if (!state->reached)
+            {
+                current->reached = false;
+                continue;
+            }
+            copyState(current, state);
+        }
+
+        if (current->reached && !step(verifier, &verifier->instructions[i]))
+            return false;
+    }
+
+    // running off the end of the body
+    return !current->reached;
+}
+
+bool ntVerifyFunction(const NT_DELEGATE *delegate, const NT_INSTRUCTION *instructions,
+                      const size_t *indices, const size_t begin, const size_t end,
+                      size_t *maxStack)
+{
+    assert(delegate);
+    assert(instructions);
+    assert(indices);
+    assert(begin < end);
+    assert(maxStack);
+
+    const NT_DELEGATE_TYPE *delegateType = (const NT_DELEGATE_TYPE *)delegate->object.type;
+    const size_t count = end - begin;
+
+    VERIFIER verifier = {
+        .instructions = instructions,
+        .indices = indices,
+        .begin = begin,
+        .end = end,
+        .joins = (FRAME_STATE *)ntMalloc(sizeof(FRAME_STATE) * count),
+        .targets = (bool *)ntMalloc(sizeof(bool) * count),
+        .current = {0},
+        .maxDepth = 0,
+        .returnSize = returnSize(delegateType),
+        .changed = false,
+    };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        verifier.joins[i] = (FRAME_STATE){0};
+        verifier.targets[i] = false;
+    }
+    verifier.targets[0] = true;
+
+    // branches out of the body are only an error where they can run, see join
+    for (size_t i = begin; i < end; ++i)
+    {
+        switch (instructions[i].opcode)
+        {
+        case BC_BRANCH:
+        case BC_BRANCH_Z_32:
+        case BC_BRANCH_Z_64:
+        case BC_BRANCH_NZ_32:
+        case BC_BRANCH_NZ_64: {
+            const size_t target = indices[instructions[i].value64];
+            if (target >= begin && target < end)
+                verifier.targets[target - begin] = true;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // iterate until the states at join points stop losing information
+    bool valid;
+    do
+    {
+        verifier.changed = false;
+        entryState(&verifier, delegateType);
+        valid = verify(&verifier);
+    } while (valid && verifier.changed);
+
+    const size_t entryDepth = paramsSize(delegateType);
+    *maxStack = verifier.maxDepth > entryDepth ? verifier.maxDepth - entryDepth : 0;
+
+    for (size_t i = 0; i < count; ++i)
+        ntFree(verifier.joins[i].types);
+    ntFree(verifier.current.types);
+    ntFree(verifier.targets);
+    ntFree(verifier.joins);
+    return valid;
+}
@@ -26,31 +26,235 @@ SOFTWARE.
 #include <float.h>
 #include <math.h>
 #include <netuno/debug.h>
+#include <netuno/instruction.h>
+#include <netuno/jit.h>
 #include <netuno/memory.h>
 #include <netuno/module.h>
 #include <netuno/object.h>
 #include <netuno/opcode.h>
 #include <netuno/str.h>
 #include <netuno/string.h>
+#include <netuno/tracelog.h>
 #include <netuno/vm.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef NT_GUARD_PAGES
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+typedef NT_FRAME RETURN_ADR;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NT_THREADED_DISPATCH
+#endif
+
+static uint8_t HOST_CODE[] = {BC_HALT};
+static NT_INSTRUCTION HOST_INSTRUCTIONS[] = {{.opcode = BC_HALT}};
+static size_t HOST_PCS[] = {0};
+static const NT_MODULE HOST_MODULE = {
+    .code =
+        {
+            .size = sizeof(HOST_CODE),
+            .count = sizeof(HOST_CODE),
+            .data = HOST_CODE,
+        },
+    .instructions = HOST_INSTRUCTIONS,
+    .instructionPcs = HOST_PCS,
+    .instructionCount = 1,
+};
+
+#ifdef NT_GUARD_PAGES
+// bytes of PROT_NONE above a guarded stack, larger frames are still checked
+#define GUARD_SIZE (64 * 1024)
+// signal stack of each thread running a guarded VM, the overflow may have used up its own
+#define SIGNAL_STACK_SIZE (64 * 1024)
 
 typedef struct
 {
-    size_t pc;
-    const NT_MODULE *module;
-} RETURN_ADR;
+    NT_VM *vm;
+    sigjmp_buf overflow;
+} GUARD_SCOPE;
+
+static _Thread_local GUARD_SCOPE *guardScope = NULL;
+// set while this thread runs the interpreter or compiled code, natives clear it
+static _Thread_local volatile sig_atomic_t interpreting = false;
+static pthread_key_t signalStackKey;
+static struct sigaction previousAction;
+static pthread_once_t handlerOnce = PTHREAD_ONCE_INIT;
+
+#define INTERPRETING(value)                                                                       \
+    const sig_atomic_t outerInterpreting = interpreting;                                          \
+    interpreting = (value)
+#define END_INTERPRETING() interpreting = outerInterpreting
+
+static bool inGuard(const uint8_t *address, const uint8_t *end)
+{
+    return address >= end && address < end + GUARD_SIZE;
+}
+
+// hands a fault that is no overflow to the handler installed before, which stays in place
+static void chainHandler(int signal, siginfo_t *info, void *context)
+{
+    if (previousAction.sa_flags & SA_SIGINFO)
+        previousAction.sa_sigaction(signal, info, context);
+    else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN)
+        previousAction.sa_handler(signal);
+    else
+    {
+        // the process ends either way, the signal is delivered again once the handler returns
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = SIG_DFL;
+        sigaction(signal, &action, NULL);
+        raise(signal);
+    }
+}
+
+// turns a fault of the interpreter in a guard of the VM this thread runs into a stack overflow
+static void guardHandler(int signal, siginfo_t *info, void *context)
+{
+    GUARD_SCOPE *scope = guardScope;
+    const uint8_t *address = (const uint8_t *)info->si_addr;
+    if (scope && interpreting &&
+        (inGuard(address, scope->vm->stackEnd) || inGuard(address, scope->vm->callStackEnd)))
+    {
+        scope->vm->stackOverflow = true;
+        siglongjmp(scope->overflow, 1);
+    }
+
+    chainHandler(signal, info, context);
+}
+
+// a thread that ran guarded VMs gives its signal stack back when it exits
+static void freeSignalStack(void *stack)
+{
+    const stack_t disable = {.ss_flags = SS_DISABLE};
+    sigaltstack(&disable, NULL);
+    ntFree(stack);
+}
+
+static void installHandler(void)
+{
+    pthread_key_create(&signalStackKey, freeSignalStack);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = guardHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previousAction);
+}
+
+static size_t pageAlign(const size_t size)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+// the kernel only backs the pages a stack touches, so mapping it at its limit costs nothing
+static uint8_t *mapStack(const size_t size)
+{
+    uint8_t *stack = mmap(NULL, size + GUARD_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (stack == MAP_FAILED)
+        return NULL;
+    if (mprotect(stack + size, GUARD_SIZE, PROT_NONE) != 0)
+    {
+        munmap(stack, size + GUARD_SIZE);
+        return NULL;
+    }
+    return stack;
+}
 
-NT_VM *ntCreateVM(void)
+static bool guardStacks(NT_VM *vm, size_t stackLimit, size_t callStackLimit)
 {
+    stackLimit = pageAlign(stackLimit);
+    callStackLimit = pageAlign(callStackLimit);
+
+    uint8_t *stack = mapStack(stackLimit);
+    if (!stack)
+        return false;
+    uint8_t *callStack = mapStack(callStackLimit);
+    if (!callStack)
+    {
+        munmap(stack, stackLimit + GUARD_SIZE);
+        return false;
+    }
+    pthread_once(&handlerOnce, installHandler);
+
+    // at their limit from the start, the stacks never grow
+    vm->stack = stack;
+    vm->stackEnd = stack + stackLimit;
+    vm->stackLimit = stackLimit;
+    vm->callStack = callStack;
+    vm->callStackEnd = callStack + callStackLimit;
+    vm->callStackLimit = callStackLimit;
+    vm->guarded = true;
+    return true;
+}
+#else
+#define INTERPRETING(value)
+#define END_INTERPRETING()
+#endif
+
+static const NT_VM_CONFIG DEFAULT_CONFIG = {
+    .stackSize = NT_STACK_SIZE,
+    .stackLimit = NT_STACK_LIMIT,
+    .callStackSize = NT_CALL_STACK_SIZE,
+    .callStackLimit = NT_CALL_STACK_LIMIT,
+    .invokeLimit = NT_INVOKE_LIMIT,
+    .flags = 0,
+};
+
+NT_VM *ntCreateVM(const NT_VM_CONFIG *config)
+{
+    if (!config)
+        config = &DEFAULT_CONFIG;
+
+    // sizes of zero would never double
+    const size_t stackLimit = config->stackLimit ? config->stackLimit : 1;
+    const size_t callStackLimit = config->callStackLimit ? config->callStackLimit : 1;
+    size_t stackSize = config->stackSize ? config->stackSize : 1;
+    size_t callStackSize = config->callStackSize ? config->callStackSize : 1;
+    if (stackSize > stackLimit)
+        stackSize = stackLimit;
+    if (callStackSize > callStackLimit)
+        callStackSize = callStackLimit;
+
     NT_VM *vm = (NT_VM *)ntMalloc(sizeof(NT_VM));
-    vm->stack = ntMalloc(STACK_MAX);
+    vm->guarded = false;
+#ifdef NT_GUARD_PAGES
+    if (!(config->flags & NT_VM_GUARD_PAGES) || !guardStacks(vm, stackLimit, callStackLimit))
+#endif
+    {
+        vm->stack = ntMalloc(stackSize);
+        vm->stackEnd = vm->stack + stackSize;
+        vm->stackLimit = stackLimit;
+        vm->callStack = ntMalloc(callStackSize);
+        vm->callStackEnd = vm->callStack + callStackSize;
+        vm->callStackLimit = callStackLimit;
+    }
     vm->stackTop = vm->stack;
-    vm->stackOverflow = false;
-    vm->callStack = ntMalloc(CALL_STACK_MAX);
     vm->callStackTop = vm->callStack;
+    vm->stackOverflow = false;
+    vm->invokeDepth = 0;
+    vm->invokeLimit = config->invokeLimit;
+    vm->fuel = NT_FUEL_UNLIMITED;
+    vm->interpret = 0;
+    vm->fiber = NULL;
+    vm->sequence = 0;
+    vm->traceLog = NULL;
+#ifdef NT_OPCODE_COUNTS
+    vm->counts = ntCreateOpcodeCounts();
+#endif
 #ifdef DEBUG_TRACE_EXECUTION
-    vm->stackType = (size_t *)ntMalloc(sizeof(size_t) * STACK_MAX);
+    vm->stackType = (size_t *)ntMalloc(sizeof(size_t) * (vm->stackEnd - vm->stack));
     vm->stackTypeTop = vm->stackType;
 #endif
     return vm;
@@ -58,30 +262,135 @@ NT_VM *ntCreateVM(void)
 
 void ntFreeVM(NT_VM *vm)
 {
+#ifdef NT_OPCODE_COUNTS
+    // a pooled task VM hands its counts on after every task, so it may have none left
+    if (vm->counts->history)
+        ntWriteOpcodeCounts(vm->counts, stderr);
+    ntFree(vm->counts);
+#endif
 #ifdef DEBUG_TRACE_EXECUTION
     ntFree(vm->stackType);
 #endif
+#ifdef NT_GUARD_PAGES
+    if (vm->guarded)
+    {
+        munmap(vm->callStack, vm->callStackLimit + GUARD_SIZE);
+        munmap(vm->stack, vm->stackLimit + GUARD_SIZE);
+        ntFree(vm);
+        return;
+    }
+#endif
+    ntFree(vm->callStack);
     ntFree(vm->stack);
     ntFree(vm);
 }
 
 void ntResetStack(NT_VM *vm)
 {
+    vm->module = NULL;
+    vm->assembly = NULL;
+    vm->pc = NULL;
     vm->stackTop = vm->stack;
+    vm->callStackTop = vm->callStack;
+    vm->invokeDepth = 0;
+    vm->fuel = NT_FUEL_UNLIMITED;
+    // the next user of a pooled VM sets up its own fuel, profile and trace log
+    vm->interpret = 0;
+    vm->traceLog = NULL;
     vm->stackOverflow = false;
+    vm->fiber = NULL;
+    // an overflow may have unwound a transition halfway
+    vm->sequence = 0;
 #ifdef DEBUG_TRACE_EXECUTION
     vm->stackTypeTop = vm->stackType;
 #endif
 }
 
-bool ntPush(NT_VM *vm, const void *data, const size_t dataSize)
+NT_VM_POOL *ntCreateVMPool(const NT_VM_CONFIG *config, size_t count)
 {
-    const size_t available = STACK_MAX - (vm->stackTop - vm->stack);
-    if (available < dataSize)
+    NT_VM_POOL *pool = (NT_VM_POOL *)ntMalloc(sizeof(NT_VM_POOL));
+    pool->config = config ? *config : DEFAULT_CONFIG;
+    ntInitArray(&pool->idle);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        NT_VM *vm = ntCreateVM(&pool->config);
+        ntArrayAdd(&pool->idle, &vm, sizeof(NT_VM *));
+    }
+    return pool;
+}
+
+void ntFreeVMPool(NT_VM_POOL *pool)
+{
+    const NT_VM **vms = (const NT_VM **)pool->idle.data;
+    for (size_t i = 0; i < pool->idle.count / sizeof(NT_VM *); ++i)
+        ntFreeVM((NT_VM *)vms[i]);
+
+    ntDeinitArray(&pool->idle);
+    ntFree(pool);
+}
+
+NT_VM *ntAcquireVM(NT_VM_POOL *pool)
+{
+    if (pool->idle.count == 0)
+        return ntCreateVM(&pool->config);
+
+    // the idle VMs were reset on release, so handing one out is a pop
+    pool->idle.count -= sizeof(NT_VM *);
+    NT_VM *vm;
+    ntMemcpy(&vm, pool->idle.data + pool->idle.count, sizeof(NT_VM *));
+    return vm;
+}
+
+void ntReleaseVM(NT_VM_POOL *pool, NT_VM *vm)
+{
+    ntResetStack(vm);
+    ntArrayAdd(&pool->idle, &vm, sizeof(NT_VM *));
+}
+
+// Doubles the capacity of a stack until size more bytes fit, moving the stack as a whole.
+// Nothing keeps a pointer into the stacks across a push, the interpreter and compiled code
+// reload the top from the VM after every call.
+static bool growStack(uint8_t **stack, uint8_t **stackTop, uint8_t **stackEnd, const size_t limit,
+                      const size_t size)
+{
+    const size_t used = *stackTop - *stack;
+    if (size > limit - used)
+        return false;
+
+    size_t capacity = *stackEnd - *stack;
+    while (capacity - used < size)
+        capacity = capacity > limit / 2 ? limit : capacity * 2;
+
+    *stack = ntRealloc(*stack, capacity);
+    *stackTop = *stack + used;
+    *stackEnd = *stack + capacity;
+    return true;
+}
+
+// makes room for size bytes above the top of the operand stack
+static bool reserveStack(NT_VM *vm, const size_t size)
+{
+    if ((size_t)(vm->stackEnd - vm->stackTop) >= size)
+        return true;
+
+    if (!growStack(&vm->stack, &vm->stackTop, &vm->stackEnd, vm->stackLimit, size))
     {
         vm->stackOverflow = true;
         return false;
     }
+#ifdef DEBUG_TRACE_EXECUTION
+    const size_t types = vm->stackTypeTop - vm->stackType;
+    vm->stackType = ntRealloc(vm->stackType, sizeof(size_t) * (vm->stackEnd - vm->stack));
+    vm->stackTypeTop = vm->stackType + types;
+#endif
+    return true;
+}
+
+bool ntPush(NT_VM *vm, const void *data, const size_t dataSize)
+{
+    if (!reserveStack(vm, dataSize))
+        return false;
     ntMemcpy(vm->stackTop, data, dataSize);
     vm->stackTop += dataSize;
 
@@ -105,13 +414,42 @@ bool ntPeek(NT_VM *vm, void *data, const size_t dataSize, size_t offset)
     return true;
 }
 
+// A sample taken between the two sees the sequence odd and is dropped, it would pair the call
+// stack of one function with the pc of another.
+static void beginTransition(NT_VM *vm)
+{
+    vm->sequence++;
+    atomic_signal_fence(memory_order_seq_cst);
+}
+
+static void endTransition(NT_VM *vm)
+{
+    atomic_signal_fence(memory_order_seq_cst);
+    vm->sequence++;
+}
+
+// moves the VM to pc in module, as a single step for samples
+static void moveTo(NT_VM *vm, const NT_MODULE *module, const NT_INSTRUCTION *pc)
+{
+    beginTransition(vm);
+    vm->module = module;
+    vm->pc = pc;
+    endTransition(vm);
+}
+
+// inside a transition, since the call stack may move
 static bool pushCall(NT_VM *vm, const RETURN_ADR value)
 {
-    const size_t available = CALL_STACK_MAX - (vm->callStackTop - vm->callStack);
-    if (available < sizeof(value))
+    // a guarded call stack faults instead
+    if (!vm->guarded && (size_t)(vm->callStackEnd - vm->callStackTop) < sizeof(value))
     {
-        vm->stackOverflow = true;
-        return false;
+        const bool grown = growStack(&vm->callStack, &vm->callStackTop, &vm->callStackEnd,
+                                     vm->callStackLimit, sizeof(value));
+        if (!grown)
+        {
+            vm->stackOverflow = true;
+            return false;
+        }
     }
     ntMemcpy(vm->callStackTop, &value, sizeof(value));
     vm->callStackTop += sizeof(value);
@@ -132,17 +470,65 @@ static bool popCall(NT_VM *vm, RETURN_ADR *value)
     return true;
 }
 
+static bool returnCall(NT_VM *vm)
+{
+    beginTransition(vm);
+    RETURN_ADR value;
+    const bool result = popCall(vm, &value);
+    if (result)
+    {
+        vm->module = value.module;
+        vm->pc = value.pc;
+    }
+    endTransition(vm);
+    return result;
+}
+
 static bool ntWriteSp(NT_VM *vm, const void *data, const size_t dataSize, size_t offset)
 {
+#ifdef DEBUG_TRACE_EXECUTION
     const size_t available = vm->stackTop - vm->stack;
 
     if (available <= offset)
         return false;
     if (available - offset < dataSize)
         return false;
+#endif
+
+    memcpy(vm->stackTop - dataSize - offset, data, dataSize);
+    return true;
+}
+
+// moves the stack top by the delta of a register instruction
+static bool adjustStack(NT_VM *vm, const int16_t delta)
+{
+#ifndef DEBUG_TRACE_EXECUTION
+    vm->stackTop += delta;
+    return true;
+#else
+    if (delta < 0)
+        return ntPop(vm, NULL, (size_t)-delta);
+
+    if (!reserveStack(vm, (size_t)delta))
+        return false;
+    vm->stackTop += delta;
 
-    ntMemcpy(vm->stackTop - dataSize - offset, data, dataSize);
+    for (int16_t i = 0; i < delta; i += sizeof(uint32_t))
+        *vm->stackTypeTop++ = sizeof(uint32_t);
     return true;
+#endif
+}
+
+static uint32_t readSlot32(const uint8_t *slot)
+{
+    uint32_t value;
+    memcpy(&value, slot, sizeof(uint32_t));
+    return value;
+}
+
+static void writeSlot32(uint8_t *slot, const uint32_t value)
+{
+    memcpy(slot, &value, sizeof(uint32_t));
 }
 
 bool ntPop(NT_VM *vm, void *data, const size_t dataSize)
@@ -199,84 +585,179 @@ bool ntPop64(NT_VM *vm, uint64_t *value)
     return ntPop(vm, value, sizeof(uint64_t));
 }
 
-bool ntCall(NT_VM *vm, const NT_DELEGATE *delegate)
+// Stack access of the interpreter loop. Code only runs after ntVerifyFunction proved its depth
+// and ntCall reserved its maxStack, so these skip the bounds checks of the public functions
+// unless execution is traced.
+static bool stackPush(NT_VM *vm, const void *data, const size_t dataSize)
 {
-    assert(vm);
-    assert(delegate);
-    assert(delegate->object.type);
-    assert(delegate->object.type->objectType == NT_OBJECT_DELEGATE);
+#ifdef DEBUG_TRACE_EXECUTION
+    return ntPush(vm, data, dataSize);
+#else
+    memcpy(vm->stackTop, data, dataSize);
+    vm->stackTop += dataSize;
+    return true;
+#endif
+}
 
+static bool stackPop(NT_VM *vm, void *data, const size_t dataSize)
+{
 #ifdef DEBUG_TRACE_EXECUTION
-    {
-        const NT_STRING *str = ntToString((NT_OBJECT *)delegate);
-        char *name = ntToCharFixed(str->chars, str->length);
-        ntFreeObject((NT_OBJECT *)str);
+    return ntPop(vm, data, dataSize);
+#else
+    vm->stackTop -= dataSize;
+    if (data)
+        memcpy(data, vm->stackTop, dataSize);
+    return true;
+#endif
+}
 
-        printf("%s:\n", name);
-        ntFree(name);
-    }
+static bool stackPeek(NT_VM *vm, void *data, const size_t dataSize, const size_t offset)
+{
+#ifdef DEBUG_TRACE_EXECUTION
+    return ntPeek(vm, data, dataSize, offset);
+#else
+    memcpy(data, vm->stackTop - dataSize - offset, dataSize);
+    return true;
 #endif
+}
 
-    if (delegate->native)
-    {
-        const NT_DELEGATE_TYPE *delegateType = (const NT_DELEGATE_TYPE *)delegate->object.type;
-        uint8_t *finalStack = vm->stackTop;
+static bool stackPush32(NT_VM *vm, const uint32_t value)
+{
+    return stackPush(vm, &value, sizeof(uint32_t));
+}
 
-        for (size_t i = 0; i < delegateType->paramCount; ++i)
-        {
-            const NT_PARAM *const param = &delegateType->params[i];
-            finalStack -= param->type->stackSize;
-        }
+static bool stackPop32(NT_VM *vm, uint32_t *value)
+{
+    return stackPop(vm, value, sizeof(uint32_t));
+}
 
-        if (delegateType->returnType)
-            finalStack += delegateType->returnType->stackSize;
+static bool stackPush64(NT_VM *vm, const uint64_t value)
+{
+    return stackPush(vm, &value, sizeof(uint64_t));
+}
 
-        const bool result = delegate->func(vm, delegateType);
-        const int64_t delta = (int64_t)vm->stackTop - (int64_t)finalStack;
-        if (delta < 0)
-            ntPop(vm, NULL, -delta);
-        else if (delta > 0)
-        {
-            printf("Something is wrong with the native delegate, it delivered a smaller stack than "
-                   "expected.\n");
-            return false;
-        }
+static bool stackPop64(NT_VM *vm, uint64_t *value)
+{
+    return stackPop(vm, value, sizeof(uint64_t));
+}
+
+static bool stackPushRef(NT_VM *vm, const NT_REF value)
+{
+    return stackPush(vm, &value, sizeof(NT_REF));
+}
+
+static bool stackPopRef(NT_VM *vm, NT_REF *value)
+{
+    return stackPop(vm, value, sizeof(NT_REF));
+}
 
+// The verifier bounded the frame, so its pushes need no checks of their own. A guarded stack
+// only checks frames that could step over its guard.
+static bool reserveFrame(NT_VM *vm, const size_t maxStack)
+{
+#ifdef NT_GUARD_PAGES
+    if (vm->guarded && maxStack <= GUARD_SIZE)
+        return true;
+#endif
+    return reserveStack(vm, maxStack);
+}
+
+// natives run in place and must leave exactly their return value where the arguments were
+static bool callNative(NT_VM *vm, const NT_DELEGATE *delegate)
+{
+    // an offset, since the stack can move while the native pushes
+    const size_t finalStack = (vm->stackTop - vm->stack) - delegate->paramsSize +
+                              delegate->returnSize;
+    const NT_FIBER *fiber = vm->fiber;
+    // a fault in a native is no overflow of the VM, whatever address it hits
+    INTERPRETING(false);
+    const bool result = delegate->func(vm, (const NT_DELEGATE_TYPE *)delegate->object.type);
+    END_INTERPRETING();
+    // a yield left the stacks of the fiber behind, its resume completes the call
+    if (vm->fiber != fiber)
         return result;
+    const int64_t delta = (int64_t)(vm->stackTop - vm->stack) - (int64_t)finalStack;
+    if (delta < 0)
+        ntPop(vm, NULL, -delta);
+    else if (delta > 0)
+    {
+        printf("Something is wrong with the native delegate, it delivered a smaller stack than "
+               "expected.\n");
+        return false;
     }
-    else
+
+    return result;
+}
+
+// A tail call enters the function without a return address of its own, the function then
+// returns for its caller.
+static bool callFunction(NT_VM *vm, const NT_DELEGATE *delegate, const bool tail)
+{
+    if (!reserveFrame(vm, delegate->maxStack))
+        return false;
+
+#ifdef NT_JIT
+    if (delegate->calls < NT_JIT_THRESHOLD &&
+        ++((NT_DELEGATE *)delegate)->calls == NT_JIT_THRESHOLD)
+        ntJitCompile((NT_DELEGATE *)delegate);
+    if (delegate->jit && !vm->fiber && !vm->interpret)
+        return ntJitEnter(vm, delegate) && (!tail || returnCall(vm));
+#endif
+
+    beginTransition(vm);
+    const bool result = tail || pushCall(vm, (RETURN_ADR){
+                                              .module = vm->module,
+                                              .pc = vm->pc,
+                                          });
+    if (result)
     {
-        pushCall(vm, (RETURN_ADR){
-                         .module = vm->module,
-                         .pc = vm->pc,
-                     });
+        assert(delegate->entry);
         vm->module = delegate->sourceModule;
-        vm->pc = delegate->addr;
-        return true;
+        vm->pc = delegate->entry;
     }
-    return false;
+    endTransition(vm);
+    return result;
 }
 
-static uint32_t readConst32(NT_VM *vm)
+// moves the arguments of a tail call down over the frame they replace
+static bool slideArguments(NT_VM *vm, const size_t paramsSize, const size_t frameSize)
 {
-    uint64_t constant;
-    vm->pc += ntReadVariant(vm->module, vm->pc, &constant);
+#ifdef DEBUG_TRACE_EXECUTION
+    uint8_t arguments[UINT8_MAX * sizeof(uint64_t)];
+    assert(paramsSize <= sizeof(arguments));
+    return ntPop(vm, arguments, paramsSize) && ntPop(vm, NULL, frameSize) &&
+           ntPush(vm, arguments, paramsSize);
+#else
+    memmove(vm->stackTop - paramsSize - frameSize, vm->stackTop - paramsSize, paramsSize);
+    vm->stackTop -= frameSize;
+    return true;
+#endif
+}
 
-    uint32_t value;
-    const size_t size = ntArrayGetU32(&vm->module->constants, constant, &value);
-    assert(size);
-    return value;
+#ifdef DEBUG_TRACE_EXECUTION
+static void traceCall(const NT_DELEGATE *delegate)
+{
+    const NT_STRING *str = ntToString((NT_OBJECT *)delegate);
+    char *name = ntToCharFixed(str->chars, str->length);
+    ntFreeObject((NT_OBJECT *)str);
+
+    printf("%s:\n", name);
+    ntFree(name);
 }
+#define TRACE_CALL(delegate) traceCall(delegate)
+#else
+#define TRACE_CALL(delegate)
+#endif
 
-static uint64_t readConst64(NT_VM *vm)
+bool ntCall(NT_VM *vm, const NT_DELEGATE *delegate)
 {
-    uint64_t constant;
-    vm->pc += ntReadVariant(vm->module, vm->pc, &constant);
+    assert(vm);
+    assert(delegate);
+    assert(delegate->object.type);
+    assert(delegate->object.type->objectType == NT_OBJECT_DELEGATE);
 
-    uint64_t value;
-    const size_t size = ntArrayGetU64(&vm->module->constants, constant, &value);
-    assert(size);
-    return value;
+    TRACE_CALL(delegate);
+    return delegate->native ? callNative(vm, delegate) : callFunction(vm, delegate, false);
 }
 
 static void printHex(const uint8_t *data, const size_t size)
@@ -777,1310 +1258,2141 @@ static uint64_t popcount64(const uint64_t value)
     return (uint64_t)__builtin_popcountl(value);
 }
 
-static NT_RESULT run(NT_VM *vm)
+// reads a 32-bit value while the top slot is cached, offsets count from the cached top
+static bool peekCached32(NT_VM *vm, uint32_t *value, const size_t offset, const uint32_t top)
 {
-    for (;;)
+    if (offset == 0)
     {
-        if (vm->module == NULL && vm->pc == SIZE_MAX)
-        {
-            return NT_OK;
-        }
-        assert(vm->module != NULL && vm->pc != SIZE_MAX);
+        *value = top;
+        return true;
+    }
+    assert(offset >= sizeof(uint32_t));
+    return stackPeek(vm, value, sizeof(uint32_t), offset - sizeof(uint32_t));
+}
 
 #ifdef DEBUG_TRACE_EXECUTION
-        printf("          ");
-        size_t debugOffset = 0;
-        for (size_t *i = vm->stackType; i < vm->stackTypeTop; ++i)
-        {
-            printf("[");
-            printHex(vm->stack + debugOffset, *i);
-            printf("]");
-            debugOffset += *i;
-        }
-        printf("\n");
-        ntDisassembleInstruction(vm->assembly, vm->module, vm->pc);
+static void traceInstruction(NT_VM *vm, const bool cached, const uint32_t top)
+{
+    printf("          ");
+    size_t debugOffset = 0;
+    for (size_t *i = vm->stackType; i < vm->stackTypeTop; ++i)
+    {
+        printf("[");
+        printHex(vm->stack + debugOffset, *i);
+        printf("]");
+        debugOffset += *i;
+    }
+    if (cached)
+    {
+        printf("(");
+        printHex((const uint8_t *)&top, sizeof(uint32_t));
+        printf(")");
+    }
+    printf("\n");
+    ntDisassembleTranslated(vm->module, vm->pc);
+}
+#define TRACE_INSTRUCTION(vm) traceInstruction(vm, cached, top)
+#else
+#define TRACE_INSTRUCTION(vm)
 #endif
 
-        uint8_t instruction;
-        uint64_t t64_1;
-        uint64_t t64_2;
-        uint64_t t64_3;
-        uint32_t t32_1;
-        uint32_t t32_2;
-        bool result;
-        switch (instruction = ntRead(vm->module, vm->pc++))
-        {
-        case BC_BRANCH:
-            // t64_1 = offset between current instruction and target
-            // t64_2 = bytes used by offset in current instruction
-            // because current instruction is in PC - 1
-            // target offset is t64_1 - 1
-            // this is same for BRANCH_Z_32 and BRANCH_Z_64 instructions
-            t64_2 = ntReadVariant(vm->module, vm->pc, &t64_1);
-            vm->pc += t64_1 - 1;
-            break;
-        case BC_BRANCH_Z_32:
-            t64_2 = ntReadVariant(vm->module, vm->pc, &t64_1);
-            if (!ntPeek(vm, &t32_1, sizeof(uint32_t), 0))
-            {
-                printf("Empty stack!");
-                assert(false);
-                break;
-            }
-
-            if (t32_1 == 0)
-                vm->pc += t64_1 - 1;
-            else
-                vm->pc += t64_2;
-            break;
-        case BC_BRANCH_Z_64:
-            t64_2 = ntReadVariant(vm->module, vm->pc, &t64_1);
-            if (!ntPeek(vm, &t64_3, sizeof(uint32_t), vm->pc))
-            {
-                printf("Empty stack!");
-                assert(false);
-                break;
-            }
+#ifdef NT_OPCODE_COUNTS
+#define COUNT_INSTRUCTION(vm) ntCountOpcode(vm->counts, instruction->opcode)
+#else
+#define COUNT_INSTRUCTION(vm)
+#endif
 
-            if (t64_3 == 0)
-                vm->pc += t64_1 - 1;
-            else
-                vm->pc += t64_2;
-            break;
-        case BC_BRANCH_NZ_32:
-            t64_2 = ntReadVariant(vm->module, vm->pc, &t64_1);
-            if (!ntPeek(vm, &t32_1, sizeof(uint32_t), 0))
-            {
-                printf("Empty stack!");
-                assert(false);
-                break;
-            }
+// threaded dispatch logs through tables of its own, a switch tests for the log every time
+#ifdef NT_THREADED_DISPATCH
+#define VM_LOG(vm)
+#else
+#define VM_LOG(vm)                                                                                 \
+    if (vm->traceLog)                                                                              \
+    ntLogInstruction(vm->traceLog, vm->module, instruction,                                        \
+                     vm->stackTop - vm->stack + (cached ? sizeof(uint32_t) : 0))
+#endif
 
-            if (t32_1 != 0)
-                vm->pc += t64_1 - 1;
-            else
-                vm->pc += t64_2;
-            break;
-        case BC_BRANCH_NZ_64:
-            t64_2 = ntReadVariant(vm->module, vm->pc, &t64_1);
-            if (!ntPeek(vm, &t64_3, sizeof(uint32_t), vm->pc))
-            {
-                printf("Empty stack!");
-                assert(false);
-                break;
-            }
+// Stops the run before the instruction that found the tank empty, so ntContinue charges it again.
+// Natives and fibers nest on the native stack and keep going, the run stops at the next charge
+// outside of them.
+static bool outOfFuel(NT_VM *vm, const NT_INSTRUCTION *instruction)
+{
+    if (vm->invokeDepth > 0 || vm->fiber)
+        return false;
+    vm->pc = instruction;
+    return true;
+}
 
-            if (t64_3 != 0)
-                vm->pc += t64_1 - 1;
-            else
-                vm->pc += t64_2;
-            break;
+#define VM_CHARGE()                                                                                \
+    if (vm->fuel == 0 ? outOfFuel(vm, instruction) : (--vm->fuel, false))                        \
+    return NT_YIELD
+
+// Only calls can overflow a stack of verified code, so they are the only ones that test for it.
+#define VM_FETCH()                                                                                 \
+    do                                                                                             \
+    {                                                                                              \
+        TRACE_INSTRUCTION(vm);                                                                     \
+        instruction = vm->pc++;                                                                    \
+        COUNT_INSTRUCTION(vm);                                                                     \
+        VM_LOG(vm);                                                                                \
+    } while (0)
+
+// With labels-as-values every handler ends with its own indirect jump, so the branch predictor
+// sees one jump site per opcode instead of a single shared switch.
+//
+// The top 32-bit slot of the stack may live in the local top instead of vm->stack. Handlers
+// that end with VM_BREAK_CACHED leave it there, and the next instruction dispatches to its
+// VM_CACHED_CASE entry. Instructions without one spill the slot back to memory first, so calls,
+// natives and anything else that walks the stack always find it complete.
+#ifdef NT_THREADED_DISPATCH
+#define VM_DISPATCH() goto *dispatch[instruction->opcode];
+#define VM_CASE(op) OP_##op:
+#define VM_CACHED_CASE(op) CACHED_##op:
+#define VM_DEFAULT OP_UNKNOWN:
+#define VM_BREAK                                                                                   \
+    cached = false;                                                                                \
+    VM_FETCH();                                                                                    \
+    goto *dispatch[instruction->opcode]
+#define VM_BREAK_CACHED                                                                            \
+    cached = true;                                                                                 \
+    VM_FETCH();                                                                                    \
+    goto *cachedDispatch[instruction->opcode]
+#else
+#define VM_CACHED (UINT8_MAX + 1)
+#define VM_DISPATCH() switch (instruction->opcode + (cached ? VM_CACHED : 0))
+#define VM_CASE(op) case BC_##op:
+#define VM_CACHED_CASE(op) case BC_##op + VM_CACHED:
+#define VM_DEFAULT unknown:
+#define VM_BREAK                                                                                   \
+    cached = false;                                                                                \
+    break
+#define VM_BREAK_CACHED                                                                            \
+    cached = true;                                                                                 \
+    break
+#endif
 
-        case BC_ZERO_32:
-            result = ntPush32(vm, 0);
-            assert(result);
-            break;
-        case BC_ZERO_64:
-            result = ntPush64(vm, 0);
-            assert(result);
-            break;
-        case BC_ZERO_F32:
-            *(float *)&t32_1 = 0.0f;
-            result = ntPush32(vm, t32_1);
-            assert(result);
-            break;
-        case BC_ZERO_F64:
-            *(double *)&t64_1 = 0.0;
-            result = ntPush64(vm, t64_1);
-            assert(result);
-            break;
-        case BC_ONE_32:
-            result = ntPush32(vm, 1);
-            assert(result);
-            break;
-        case BC_ONE_64:
-            result = ntPush64(vm, 1);
-            assert(result);
-            break;
-        case BC_ONE_F32:
-            *(float *)&t32_1 = 1.0f;
-            result = ntPush32(vm, t32_1);
-            assert(result);
-            break;
-        case BC_ONE_F64:
-            *(double *)&t64_1 = 1.0f;
-            result = ntPush32(vm, t64_1);
-            assert(result);
-            break;
-        case BC_CONST_32:
-            t32_1 = readConst32(vm);
-            result = ntPush32(vm, t32_1);
-            assert(result);
-            break;
-        case BC_CONST_64:
-            t64_1 = readConst64(vm);
-            result = ntPush64(vm, t64_1);
-            assert(result);
-            break;
-        case BC_CONST_OBJECT: {
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
+#ifdef NT_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+#ifdef NT_JIT
+static size_t callDepth(const NT_VM *vm)
+{
+    return vm->callStackTop - vm->callStack;
+}
 
-            NT_OBJECT *object = ntGetConstantObject(vm->assembly, t64_1);
-            assert(object);
-            assert(IS_VALID_OBJECT(object));
+static void abortTrace(const NT_VM *vm, NT_TRACE_RECORDER *recorder)
+{
+    // the loop counts up to its threshold again before the next attempt, unless the assembly
+    // was frozen while recording
+    ((NT_INSTRUCTION *)recorder->loop)->operand = vm->assembly->frozen ? UINT32_MAX : 0;
+    recorder->loop = NULL;
+}
 
-            result = ntPushRef(vm, (NT_REF)object);
-            assert(result);
-            break;
+// Counts a backward branch in the operand BRANCH leaves unused. A hot loop starts recording its
+// next iteration, which ends when the same frame reaches the branch again. Loops of the
+// functions it calls neither count nor disturb the recording.
+static void traceLoop(const NT_VM *vm, NT_TRACE_RECORDER *recorder,
+                      const NT_INSTRUCTION *instruction)
+{
+    NT_INSTRUCTION *branch = (NT_INSTRUCTION *)instruction;
+    if (recorder->loop)
+    {
+        if (callDepth(vm) > recorder->callDepth)
+            return;
+        if (recorder->loop != instruction || recorder->callDepth != callDepth(vm))
+        {
+            abortTrace(vm, recorder);
+            return;
         }
-        case BC_LOAD_SP_32:
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
 
-            result = ntPeek(vm, &t32_1, sizeof(uint32_t), t64_1);
-            assert(result);
-            result = ntPush32(vm, t32_1);
-            assert(result);
-            break;
-        case BC_LOAD_SP_64:
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
+        if (vm->assembly->frozen || !ntJitCompileTrace(vm->module, recorder))
+            branch->operand = UINT32_MAX;
+        recorder->loop = NULL;
+        return;
+    }
+
+    if (branch->operand >= NT_TRACE_THRESHOLD || ++branch->operand < NT_TRACE_THRESHOLD)
+        return;
+
+    recorder->loop = instruction;
+    recorder->callDepth = callDepth(vm);
+    recorder->count = 0;
+}
+
+// records a conditional branch taken in the frame of the loop being recorded
+static void traceBranch(const NT_VM *vm, NT_TRACE_RECORDER *recorder, const bool taken)
+{
+    if (callDepth(vm) > recorder->callDepth)
+        return;
+
+    if (callDepth(vm) < recorder->callDepth || recorder->count == NT_TRACE_BRANCHES)
+    {
+        abortTrace(vm, recorder);
+        return;
+    }
+    recorder->directions[recorder->count++] = taken;
+}
+
+#define VM_TRACE_BRANCH(taken)                                                                     \
+    if (recorder.loop)                                                                             \
+    traceBranch(vm, &recorder, (taken))
+#else
+#define VM_TRACE_BRANCH(taken)
+#endif
 
-            result = ntPeek(vm, &t64_1, sizeof(uint64_t), t64_1);
+static NT_RESULT run(NT_VM *vm)
+{
+#ifdef NT_THREADED_DISPATCH
+    static const void *const dispatchTable[UINT8_MAX + 1] = {
+#define bytecode(a) &&OP_##a,
+#include <netuno/opcode.inc>
+#undef bytecode
+        [BC_LAST ... UINT8_MAX] = &&OP_UNKNOWN,
+    };
+    static const void *const cachedTable[UINT8_MAX + 1] = {
+#define bytecode(a) &&SPILL_##a,
+#include <netuno/opcode.inc>
+#undef bytecode
+        [BC_LAST ... UINT8_MAX] = &&SPILL_UNKNOWN,
+        [BC_EQ_32] = &&CACHED_EQ_32,
+        [BC_EQ_F32] = &&CACHED_EQ_F32,
+        [BC_NE_32] = &&CACHED_NE_32,
+        [BC_NE_F32] = &&CACHED_NE_F32,
+        [BC_GT_I32] = &&CACHED_GT_I32,
+        [BC_GT_U32] = &&CACHED_GT_U32,
+        [BC_GT_F32] = &&CACHED_GT_F32,
+        [BC_LT_I32] = &&CACHED_LT_I32,
+        [BC_LT_U32] = &&CACHED_LT_U32,
+        [BC_LT_F32] = &&CACHED_LT_F32,
+        [BC_GE_I32] = &&CACHED_GE_I32,
+        [BC_GE_U32] = &&CACHED_GE_U32,
+        [BC_GE_F32] = &&CACHED_GE_F32,
+        [BC_LE_I32] = &&CACHED_LE_I32,
+        [BC_LE_U32] = &&CACHED_LE_U32,
+        [BC_LE_F32] = &&CACHED_LE_F32,
+        [BC_ADD_I32] = &&CACHED_ADD_I32,
+        [BC_ADD_F32] = &&CACHED_ADD_F32,
+        [BC_SUB_I32] = &&CACHED_SUB_I32,
+        [BC_SUB_F32] = &&CACHED_SUB_F32,
+        [BC_MUL_I32] = &&CACHED_MUL_I32,
+        [BC_MUL_F32] = &&CACHED_MUL_F32,
+        [BC_DIV_U32] = &&CACHED_DIV_U32,
+        [BC_DIV_I32] = &&CACHED_DIV_I32,
+        [BC_DIV_F32] = &&CACHED_DIV_F32,
+        [BC_REM_I32] = &&CACHED_REM_I32,
+        [BC_REM_U32] = &&CACHED_REM_U32,
+        [BC_REM_F32] = &&CACHED_REM_F32,
+        [BC_MIN_F32] = &&CACHED_MIN_F32,
+        [BC_MAX_F32] = &&CACHED_MAX_F32,
+        [BC_COPYSIGN_F32] = &&CACHED_COPYSIGN_F32,
+        [BC_AND_I32] = &&CACHED_AND_I32,
+        [BC_OR_I32] = &&CACHED_OR_I32,
+        [BC_XOR_I32] = &&CACHED_XOR_I32,
+        [BC_SHL_I32] = &&CACHED_SHL_I32,
+        [BC_SHR_I32] = &&CACHED_SHR_I32,
+        [BC_SHR_U32] = &&CACHED_SHR_U32,
+        [BC_ROL_I32] = &&CACHED_ROL_I32,
+        [BC_ROR_I32] = &&CACHED_ROR_I32,
+        [BC_NEG_I32] = &&CACHED_NEG_I32,
+        [BC_NEG_F32] = &&CACHED_NEG_F32,
+        [BC_NOT_32] = &&CACHED_NOT_32,
+        [BC_IS_ZERO_32] = &&CACHED_IS_ZERO_32,
+        [BC_IS_NOT_ZERO_32] = &&CACHED_IS_NOT_ZERO_32,
+        [BC_IS_ZERO_F32] = &&CACHED_IS_ZERO_F32,
+        [BC_IS_NOT_ZERO_F32] = &&CACHED_IS_NOT_ZERO_F32,
+        [BC_CONVERT_F32_I32] = &&CACHED_CONVERT_F32_I32,
+        [BC_CONVERT_F32_U32] = &&CACHED_CONVERT_F32_U32,
+        [BC_TRUNCATE_I32_F32] = &&CACHED_TRUNCATE_I32_F32,
+        [BC_TRUNCATE_U32_F32] = &&CACHED_TRUNCATE_U32_F32,
+        [BC_NEAREST_F32] = &&CACHED_NEAREST_F32,
+        [BC_CEIL_F32] = &&CACHED_CEIL_F32,
+        [BC_FLOOR_F32] = &&CACHED_FLOOR_F32,
+        [BC_TRUNCATE_F32] = &&CACHED_TRUNCATE_F32,
+        [BC_ABS_F32] = &&CACHED_ABS_F32,
+        [BC_SQRT_F32] = &&CACHED_SQRT_F32,
+        [BC_CLZ_I32] = &&CACHED_CLZ_I32,
+        [BC_CTZ_I32] = &&CACHED_CTZ_I32,
+        [BC_POPCNT_I32] = &&CACHED_POPCNT_I32,
+        [BC_ZERO_32] = &&CACHED_ZERO_32,
+        [BC_ONE_32] = &&CACHED_ONE_32,
+        [BC_CONST_32] = &&CACHED_CONST_32,
+        [BC_ZERO_F32] = &&CACHED_ZERO_F32,
+        [BC_ONE_F32] = &&CACHED_ONE_F32,
+        [BC_LOAD_SP_32] = &&CACHED_LOAD_SP_32,
+        [BC_STORE_SP_32] = &&CACHED_STORE_SP_32,
+        [BC_POP_32] = &&CACHED_POP_32,
+        [BC_BRANCH_Z_32] = &&CACHED_BRANCH_Z_32,
+        [BC_BRANCH_NZ_32] = &&CACHED_BRANCH_NZ_32,
+        [BC_ADD_SP_SP_I32] = &&CACHED_ADD_SP_SP_I32,
+        [BC_SUB_SP_SP_I32] = &&CACHED_SUB_SP_SP_I32,
+        [BC_ADD_SP_CONST_I32] = &&CACHED_ADD_SP_CONST_I32,
+        [BC_SUB_SP_CONST_I32] = &&CACHED_SUB_SP_CONST_I32,
+        [BC_EQ_32_BRANCH_Z] = &&CACHED_EQ_32_BRANCH_Z,
+        [BC_NE_32_BRANCH_Z] = &&CACHED_NE_32_BRANCH_Z,
+        [BC_GT_I32_BRANCH_Z] = &&CACHED_GT_I32_BRANCH_Z,
+        [BC_GT_U32_BRANCH_Z] = &&CACHED_GT_U32_BRANCH_Z,
+        [BC_LT_I32_BRANCH_Z] = &&CACHED_LT_I32_BRANCH_Z,
+        [BC_LT_U32_BRANCH_Z] = &&CACHED_LT_U32_BRANCH_Z,
+        [BC_GE_I32_BRANCH_Z] = &&CACHED_GE_I32_BRANCH_Z,
+        [BC_GE_U32_BRANCH_Z] = &&CACHED_GE_U32_BRANCH_Z,
+        [BC_LE_I32_BRANCH_Z] = &&CACHED_LE_I32_BRANCH_Z,
+        [BC_LE_U32_BRANCH_Z] = &&CACHED_LE_U32_BRANCH_Z,
+    };
+    // every entry logs the instruction before it goes on to its handler
+    static const void *const loggedTable[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&LOG_INSTRUCTION,
+    };
+    static const void *const loggedCachedTable[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&LOG_CACHED_INSTRUCTION,
+    };
+    // a VM that logs nothing dispatches through the tables of the handlers, at no cost
+    const void *const *const dispatch = vm->traceLog ? loggedTable : dispatchTable;
+    const void *const *const cachedDispatch = vm->traceLog ? loggedCachedTable : cachedTable;
+#endif
+
+    const NT_INSTRUCTION *instruction;
+    uint64_t t64_1;
+    uint64_t t64_2;
+    uint32_t t32_1;
+    uint32_t t32_2;
+    uint8_t *frame;
+    uint32_t top = 0;
+    bool cached = false;
+    bool result;
+#ifdef NT_JIT
+    NT_TRACE_RECORDER recorder = {.loop = NULL};
+#endif
+
+    for (;;)
+    {
+        VM_FETCH();
+        VM_DISPATCH()
+        {
+        VM_CASE(BRANCH)
+            if (instruction->target < instruction)
+            {
+                VM_CHARGE();
+            }
+            vm->pc = instruction->target;
+#ifdef NT_JIT
+            // a compiled trace replaces the branch, which is why its target is read first
+            if (vm->pc < instruction && !vm->fiber)
+                traceLoop(vm, &recorder, instruction);
+#endif
+            VM_BREAK;
+        VM_CASE(LOOP_TRACE)
+            VM_CHARGE();
+#ifdef NT_JIT
+            // fibers and logging VMs stay interpreted, so they take the branch the trace replaced
+            if (vm->fiber || (vm->interpret & NT_INTERPRET_LOG))
+            {
+                vm->pc = ntJitTraceHeader(instruction);
+                VM_BREAK;
+            }
+            vm->pc = ntJitEnterTrace(vm, instruction);
+            if (!vm->pc)
+                return vm->stackOverflow ? NT_STACK_OVERFLOW : NT_RUNTIME_ERROR;
+#else
+            assert(false);
+#endif
+            VM_BREAK;
+        VM_CASE(BRANCH_Z_32)
+            if (!stackPeek(vm, &t32_1, sizeof(uint32_t), 0))
+            {
+                printf("Empty stack!");
+                assert(false);
+                VM_BREAK;
+            }
+
+            if (t32_1 == 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(t32_1 == 0);
+            VM_BREAK;
+        VM_CACHED_CASE(BRANCH_Z_32)
+            if (top == 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(top == 0);
+            VM_BREAK_CACHED;
+        VM_CASE(BRANCH_Z_64)
+            if (!stackPeek(vm, &t64_1, sizeof(uint64_t), 0))
+            {
+                printf("Empty stack!");
+                assert(false);
+                VM_BREAK;
+            }
+
+            if (t64_1 == 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(t64_1 == 0);
+            VM_BREAK;
+        VM_CASE(BRANCH_NZ_32)
+            if (!stackPeek(vm, &t32_1, sizeof(uint32_t), 0))
+            {
+                printf("Empty stack!");
+                assert(false);
+                VM_BREAK;
+            }
+
+            if (t32_1 != 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(t32_1 != 0);
+            VM_BREAK;
+        VM_CACHED_CASE(BRANCH_NZ_32)
+            if (top != 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(top != 0);
+            VM_BREAK_CACHED;
+        VM_CASE(BRANCH_NZ_64)
+            if (!stackPeek(vm, &t64_1, sizeof(uint64_t), 0))
+            {
+                printf("Empty stack!");
+                assert(false);
+                VM_BREAK;
+            }
+
+            if (t64_1 != 0)
+                vm->pc = instruction->target;
+            VM_TRACE_BRANCH(t64_1 != 0);
+            VM_BREAK;
+
+        VM_CACHED_CASE(ZERO_32)
+            result = stackPush32(vm, top);
             assert(result);
-            result = ntPush64(vm, t64_1);
+        VM_CASE(ZERO_32)
+            top = 0;
+            VM_BREAK_CACHED;
+        VM_CASE(ZERO_64)
+            result = stackPush64(vm, 0);
             assert(result);
-            break;
-        case BC_STORE_SP_32:
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
-            result = ntPeek(vm, &t32_1, sizeof(uint32_t), 0);
+            VM_BREAK;
+        VM_CACHED_CASE(ZERO_F32)
+            result = stackPush32(vm, top);
             assert(result);
-            result = ntWriteSp(vm, &t32_1, sizeof(uint32_t), t64_1);
+        VM_CASE(ZERO_F32)
+            *(float *)&top = 0.0f;
+            VM_BREAK_CACHED;
+        VM_CASE(ZERO_F64)
+            *(double *)&t64_1 = 0.0;
+            result = stackPush64(vm, t64_1);
             assert(result);
-            break;
-        case BC_STORE_SP_64:
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
-            result = ntPeek(vm, &t64_2, sizeof(uint64_t), 0);
+            VM_BREAK;
+        VM_CACHED_CASE(ONE_32)
+            result = stackPush32(vm, top);
             assert(result);
-            result = ntWriteSp(vm, &t64_2, sizeof(uint64_t), t64_1);
+        VM_CASE(ONE_32)
+            top = 1;
+            VM_BREAK_CACHED;
+        VM_CASE(ONE_64)
+            result = stackPush64(vm, 1);
             assert(result);
-            break;
-
-        case BC_EQ_32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CACHED_CASE(ONE_F32)
+            result = stackPush32(vm, top);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+        VM_CASE(ONE_F32)
+            *(float *)&top = 1.0f;
+            VM_BREAK_CACHED;
+        VM_CASE(ONE_F64)
+            *(double *)&t64_1 = 1.0;
+            result = stackPush64(vm, t64_1);
             assert(result);
-            result = ntPush32(vm, t32_1 == t32_2);
+            VM_BREAK;
+        VM_CACHED_CASE(CONST_32)
+            result = stackPush32(vm, top);
             assert(result);
-            break;
-        case BC_EQ_64:
-            result = ntPop64(vm, &t64_1);
+        VM_CASE(CONST_32)
+            top = instruction->value32;
+            VM_BREAK_CACHED;
+        VM_CASE(CONST_64)
+            result = stackPush64(vm, instruction->value64);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(CONST_OBJECT)
+            result = stackPushRef(vm, (NT_REF)instruction->object);
             assert(result);
-            result = ntPush32(vm, t64_1 == t64_2);
+            VM_BREAK;
+        VM_CASE(LOAD_SP_32)
+            result = stackPeek(vm, &top, sizeof(uint32_t), instruction->operand);
             assert(result);
-            break;
-        case BC_EQ_F32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK_CACHED;
+        VM_CACHED_CASE(LOAD_SP_32)
+            result = peekCached32(vm, &t32_1, instruction->operand, top);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+            result = stackPush32(vm, top);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 == *(float *)&t32_2);
+            top = t32_1;
+            VM_BREAK_CACHED;
+        VM_CASE(LOAD_SP_64)
+            result = stackPeek(vm, &t64_1, sizeof(uint64_t), instruction->operand);
             assert(result);
-            break;
-        case BC_EQ_F64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(STORE_SP_32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), 0);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 == *(double *)&t64_2);
+            result = ntWriteSp(vm, &t32_1, sizeof(uint32_t), instruction->operand);
             assert(result);
-            break;
-
-        case BC_NE_32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CACHED_CASE(STORE_SP_32)
+            if (instruction->operand != 0)
+            {
+                result = ntWriteSp(vm, &top, sizeof(uint32_t),
+                                   instruction->operand - sizeof(uint32_t));
+                assert(result);
+            }
+            VM_BREAK_CACHED;
+        VM_CASE(STORE_SP_64)
+            result = stackPeek(vm, &t64_2, sizeof(uint64_t), 0);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+            result = ntWriteSp(vm, &t64_2, sizeof(uint64_t), instruction->operand);
             assert(result);
-            result = ntPush32(vm, t32_1 != t32_2);
+            VM_BREAK;
+
+        VM_CASE(EQ_32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_NE_64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(EQ_32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+            top = t32_1 == t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(EQ_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, t64_1 != t64_2);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_NE_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, t64_1 == t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(EQ_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 != *(float *)&t32_2);
+        VM_CACHED_CASE(EQ_F32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            break;
-        case BC_NE_F64:
-            result = ntPop64(vm, &t64_1);
+            top = *(float *)&t32_1 == *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(EQ_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 != *(double *)&t64_2);
+            result = stackPush32(vm, *(double *)&t64_1 == *(double *)&t64_2);
             assert(result);
-            break;
+            VM_BREAK;
 
-        case BC_GT_I32:
-            result = ntPop32(vm, &t32_2);
+        VM_CASE(NE_32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(NE_32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            result = ntPush32(vm, *(int32_t *)&t32_1 > *(int32_t *)&t32_2);
+            top = t32_1 != t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(NE_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_GT_U32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, t64_1 != t64_2);
             assert(result);
-            result = ntPush32(vm, t32_1 > t32_2);
+            VM_BREAK;
+        VM_CASE(NE_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_GT_I64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(NE_F32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            top = *(float *)&t32_1 != *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(NE_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, *(int64_t *)&t64_1 > *(int64_t *)&t64_2);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_GT_U64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush32(vm, *(double *)&t64_1 != *(double *)&t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+
+        VM_CASE(GT_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, t64_1 > t64_2);
+        VM_CACHED_CASE(GT_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_GT_F32:
-            result = ntPop32(vm, &t32_2);
+            top = *(int32_t *)&t32_1 > *(int32_t *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GT_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(GT_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 > *(float *)&t32_2);
+            top = t32_1 > t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GT_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_GT_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush32(vm, *(int64_t *)&t64_1 > *(int64_t *)&t64_2);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 > *(double *)&t64_2);
+            VM_BREAK;
+        VM_CASE(GT_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-
-        case BC_LT_I32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, t64_1 > t64_2);
             assert(result);
-            result = ntPush32(vm, *(int32_t *)&t32_1 < *(int32_t *)&t32_2);
+            VM_BREAK;
+        VM_CASE(GT_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_LT_U32:
-            result = ntPop32(vm, &t32_2);
+        VM_CACHED_CASE(GT_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            top = *(float *)&t32_1 > *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GT_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, t32_1 < t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_LT_I64:
-            result = ntPop64(vm, &t64_2);
-            assert(result);
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush32(vm, *(int64_t *)&t64_1 < *(int64_t *)&t64_2);
+            result = stackPush32(vm, *(double *)&t64_1 > *(double *)&t64_2);
             assert(result);
-            break;
-        case BC_LT_U64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+
+        VM_CASE(LT_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(LT_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, t64_1 < t64_2);
+            top = *(int32_t *)&t32_1 < *(int32_t *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LT_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_LT_F32:
-            result = ntPop32(vm, &t32_2);
+        VM_CACHED_CASE(LT_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            top = t32_1 < t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LT_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 < *(float *)&t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_LT_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush32(vm, *(int64_t *)&t64_1 < *(int64_t *)&t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(LT_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 < *(double *)&t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-
-        case BC_GE_I32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPush32(vm, t64_1 < t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(LT_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, *(int32_t *)&t32_1 >= *(int32_t *)&t32_2);
+        VM_CACHED_CASE(LT_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_GE_U32:
-            result = ntPop32(vm, &t32_2);
+            top = *(float *)&t32_1 < *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LT_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, t32_1 >= t32_2);
+            result = stackPush32(vm, *(double *)&t64_1 < *(double *)&t64_2);
             assert(result);
-            break;
-        case BC_GE_I64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+
+        VM_CASE(GE_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(GE_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, *(int64_t *)&t64_1 >= *(int64_t *)&t64_2);
+            top = *(int32_t *)&t32_1 >= *(int32_t *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GE_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_GE_U64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(GE_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            top = t32_1 >= t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GE_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, t64_1 >= t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_GE_F32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPush32(vm, *(int64_t *)&t64_1 >= *(int64_t *)&t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(GE_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 >= *(float *)&t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_GE_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush32(vm, t64_1 >= t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(GE_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 >= *(double *)&t64_2);
+        VM_CACHED_CASE(GE_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-
-        case BC_LE_I32:
-            result = ntPop32(vm, &t32_2);
+            top = *(float *)&t32_1 >= *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(GE_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, *(int32_t *)&t32_1 <= *(int32_t *)&t32_2);
+            result = stackPush32(vm, *(double *)&t64_1 >= *(double *)&t64_2);
             assert(result);
-            break;
-        case BC_LE_U32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+
+        VM_CASE(LE_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(LE_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, t32_1 <= t32_2);
+            top = *(int32_t *)&t32_1 <= *(int32_t *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LE_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_LE_I64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(LE_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            top = t32_1 <= t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LE_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, *(int64_t *)&t64_1 <= *(int64_t *)&t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_LE_U64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush32(vm, *(int64_t *)&t64_1 <= *(int64_t *)&t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(LE_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, t64_1 <= t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_LE_F32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPush32(vm, t64_1 <= t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(LE_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 <= *(float *)&t32_2);
+        VM_CACHED_CASE(LE_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_LE_F64:
-            result = ntPop64(vm, &t64_2);
+            top = *(float *)&t32_1 <= *(float *)&t32_2;
+            VM_BREAK_CACHED;
+        VM_CASE(LE_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, *(double *)&t64_1 <= *(double *)&t64_2);
+            result = stackPush32(vm, *(double *)&t64_1 <= *(double *)&t64_2);
             assert(result);
-            break;
+            VM_BREAK;
 
-        case BC_NEG_I32:
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(NEG_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, negate32(t32_1));
+        VM_CACHED_CASE(NEG_I32)
+            t32_1 = top;
+            top = negate32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(NEG_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_NEG_I64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, negate64(t64_1));
             assert(result);
-            result = ntPush64(vm, negate64(t64_1));
+            VM_BREAK;
+        VM_CASE(NEG_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_NEG_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(NEG_F32)
+            t32_1 = top;
+            top = negateF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(NEG_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, negateF32(t32_1));
-            assert(result);
-            break;
-        case BC_NEG_F64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, negateF64(t64_1));
             assert(result);
-            result = ntPush64(vm, negateF64(t64_1));
-            assert(result);
-            break;
+            VM_BREAK;
 
-        case BC_NOT_32:
-            result = ntPop32(vm, &t32_1);
-            assert(result);
-            result = ntPush32(vm, ~t32_1);
+        VM_CASE(NOT_32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_NOT_64:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(NOT_32)
+            t32_1 = top;
+            top = ~t32_1;
+            VM_BREAK_CACHED;
+        VM_CASE(NOT_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, ~t32_1);
+            result = stackPush64(vm, ~t64_1);
             assert(result);
-            break;
+            VM_BREAK;
 
-        case BC_IS_ZERO_32:
-            result = ntPop32(vm, &t32_1);
-            assert(result);
-            result = ntPush32(vm, t32_1 == 0);
-            break;
-        case BC_IS_NOT_ZERO_32:
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(IS_ZERO_32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, t32_1 != 0);
-            break;
-        case BC_IS_ZERO_64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(IS_ZERO_32)
+            t32_1 = top;
+            top = t32_1 == 0;
+            VM_BREAK_CACHED;
+        VM_CASE(IS_NOT_ZERO_32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, t64_1 == 0);
-            break;
-        case BC_IS_NOT_ZERO_64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(IS_NOT_ZERO_32)
+            t32_1 = top;
+            top = t32_1 != 0;
+            VM_BREAK_CACHED;
+        VM_CASE(IS_ZERO_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, t64_1 != 0);
-            break;
-        case BC_IS_ZERO_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, t64_1 == 0);
+            VM_BREAK;
+        VM_CASE(IS_NOT_ZERO_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 == 0.0f);
-            break;
-        case BC_IS_NOT_ZERO_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, t64_1 != 0);
+            VM_BREAK;
+        VM_CASE(IS_ZERO_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, *(float *)&t32_1 != 0.0f);
-            break;
-        case BC_IS_ZERO_F64:
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, *(double *)&t64_1 == 0.0);
-            break;
-        case BC_IS_NOT_ZERO_F64:
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, *(double *)&t64_1 != 0.0);
-            break;
-        case BC_CONCAT: {
+        VM_CACHED_CASE(IS_ZERO_F32)
+            t32_1 = top;
+            top = *(float *)&t32_1 == 0.0f;
+            VM_BREAK_CACHED;
+        VM_CASE(IS_NOT_ZERO_F32)
+            result = stackPop32(vm, &top);
+            assert(result);
+        VM_CACHED_CASE(IS_NOT_ZERO_F32)
+            t32_1 = top;
+            top = *(float *)&t32_1 != 0.0f;
+            VM_BREAK_CACHED;
+        VM_CASE(IS_ZERO_F64)
+            result = stackPop64(vm, &t64_1);
+            assert(result);
+            result = stackPush32(vm, *(double *)&t64_1 == 0.0);
+            VM_BREAK;
+        VM_CASE(IS_NOT_ZERO_F64)
+            result = stackPop64(vm, &t64_1);
+            assert(result);
+            result = stackPush32(vm, *(double *)&t64_1 != 0.0);
+            VM_BREAK;
+        VM_CASE(CONCAT) {
             const NT_TYPE *const objectType = ntObjectType();
 
             NT_OBJECT *obj2 = NULL;
-            result = ntPopRef(vm, (NT_REF *)&obj2);
+            result = stackPopRef(vm, (NT_REF *)&obj2);
             assert(result);
             assert(obj2);
             assert(IS_VALID_OBJECT(obj2));
             assert(ntTypeIsAssignableFrom(objectType, obj2->type));
 
             NT_OBJECT *obj1 = NULL;
-            result = ntPopRef(vm, (NT_REF *)&obj1);
+            result = stackPopRef(vm, (NT_REF *)&obj1);
             assert(result);
             assert(obj1);
             assert(IS_VALID_OBJECT(obj1));
             assert(ntTypeIsAssignableFrom(objectType, obj1->type));
 
             const NT_STRING *const resultString = ntConcat(obj1, obj2);
-            ntPushRef(vm, (NT_REF)resultString);
-            break;
+            stackPushRef(vm, (NT_REF)resultString);
+            VM_BREAK;
         }
-        case BC_ADD_I32:
-            result = ntPop32(vm, &t32_2);
+        VM_CASE(ADD_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(ADD_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, add32(t32_1, t32_2));
+            top = add32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(ADD_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_ADD_I64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, add64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, add64(t64_1, t64_2));
+            VM_BREAK;
+        VM_CASE(ADD_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_ADD_F32:
-            result = ntPop32(vm, &t32_2);
-            assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(ADD_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, addF32(t32_1, t32_2));
+            top = addF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(ADD_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_ADD_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, addF64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, addF64(t64_1, t64_2));
-            assert(result);
-            break;
+            VM_BREAK;
 
-        case BC_SUB_I32:
-            result = ntPop32(vm, &t32_2);
+        VM_CASE(SUB_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(SUB_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, sub32(t32_1, t32_2));
+            top = sub32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SUB_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_SUB_I64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, sub64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, sub64(t64_1, t64_2));
+            VM_BREAK;
+        VM_CASE(SUB_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_SUB_F32:
-            result = ntPop32(vm, &t32_2);
+        VM_CACHED_CASE(SUB_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            top = subF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SUB_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, subF32(t32_1, t32_2));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_SUB_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, subF64(t64_1, t64_2));
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(MUL_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, subF64(t64_1, t64_2));
+        VM_CACHED_CASE(MUL_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_MUL_I32:
-            result = ntPop32(vm, &t32_2);
+            top = mul32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(MUL_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, mul32(t32_1, t32_2));
+            result = stackPush64(vm, mul64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_MUL_I64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(MUL_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(MUL_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush64(vm, mul64(t64_1, t64_2));
+            top = mulF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(MUL_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_MUL_F32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, mulF64(t64_1, t64_2));
             assert(result);
-            result = ntPush32(vm, mulF32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(DIV_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_MUL_F64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(DIV_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            top = divU32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(DIV_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush64(vm, mulF64(t64_1, t64_2));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_DIV_U32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPush64(vm, divU64(t64_1, t64_2));
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(DIV_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, divU32(t32_1, t32_2));
+        VM_CACHED_CASE(DIV_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_DIV_U64:
-            result = ntPop64(vm, &t64_2);
+            top = divI32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(DIV_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, divU64(t64_1, t64_2));
+            result = stackPush64(vm, divI64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_DIV_I32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(DIV_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(DIV_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, divI32(t32_1, t32_2));
+            top = divF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(DIV_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_DIV_I64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, divF64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, divI64(t64_1, t64_2));
+            VM_BREAK;
+        VM_CASE(REM_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_DIV_F32:
-            result = ntPop32(vm, &t32_2);
+        VM_CACHED_CASE(REM_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            top = remI32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(REM_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, divF32(t32_1, t32_2));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_DIV_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, remI64(t64_1, t64_2));
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(REM_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, divF64(t64_1, t64_2));
+        VM_CACHED_CASE(REM_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_REM_I32:
-            result = ntPop32(vm, &t32_2);
+            top = remU32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(REM_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, remI32(t32_1, t32_2));
+            result = stackPush64(vm, remU64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_REM_I64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(REM_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(REM_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush64(vm, remI64(t64_1, t64_2));
+            top = remF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(REM_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_REM_U32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, remF64(t64_1, t64_2));
             assert(result);
-            result = ntPush32(vm, remU32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(EXTEND_I32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_REM_U64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, extendI32(t32_1));
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(EXTEND_U32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush64(vm, remU64(t64_1, t64_2));
+            result = stackPush64(vm, extendU32(t32_1));
             assert(result);
-            break;
-        case BC_REM_F32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(WRAP_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, *(uint32_t *)&t64_1);
             assert(result);
-            result = ntPush32(vm, remF32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(PROMOTE_F32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_REM_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, promoteF32(t32_1));
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(DEMOTE_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, remF64(t64_1, t64_2));
+            result = stackPush32(vm, demoteF64(t64_1));
             assert(result);
-            break;
-        case BC_EXTEND_I32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(CONVERT_F32_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, extendI32(t32_1));
+        VM_CACHED_CASE(CONVERT_F32_I32)
+            t32_1 = top;
+            top = convertI32ToF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(CONVERT_F32_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_EXTEND_U32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush32(vm, convertI64ToF32(t64_1));
             assert(result);
-            result = ntPush64(vm, extendU32(t32_1));
+            VM_BREAK;
+        VM_CASE(CONVERT_F32_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_WRAP_I64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(CONVERT_F32_U32)
+            t32_1 = top;
+            top = convertU32ToF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(CONVERT_F32_U64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, *(uint32_t *)&t64_1);
+            result = stackPush32(vm, convertU64ToF32(t64_1));
             assert(result);
-            break;
-        case BC_PROMOTE_F32:
-            result = ntPop32(vm, &t32_1);
-            assert(result);
-            result = ntPush64(vm, promoteF32(t32_1));
-            assert(result);
-            break;
-        case BC_DEMOTE_F64:
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush32(vm, demoteF64(t64_1));
-            assert(result);
-            break;
-        case BC_CONVERT_F32_I32:
-            result = ntPop32(vm, &t32_1);
-            assert(result);
-            result = ntPush32(vm, convertI32ToF32(t32_1));
+            VM_BREAK;
+        VM_CASE(CONVERT_F64_I32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_CONVERT_F32_I64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, convertI32ToF64(t32_1));
             assert(result);
-            result = ntPush32(vm, convertI64ToF32(t64_1));
+            VM_BREAK;
+        VM_CASE(CONVERT_F64_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_CONVERT_F32_U32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, convertI64ToF64(t64_1));
             assert(result);
-            result = ntPush32(vm, convertU32ToF32(t32_1));
+            VM_BREAK;
+        VM_CASE(CONVERT_F64_U32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_CONVERT_F32_U64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, convertU32ToF64(t32_1));
             assert(result);
-            result = ntPush32(vm, convertU64ToF32(t64_1));
+            VM_BREAK;
+        VM_CASE(CONVERT_F64_U64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_CONVERT_F64_I32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, convertU64ToF64(t64_1));
             assert(result);
-            result = ntPush64(vm, convertI32ToF64(t32_1));
-            assert(result);
-            break;
-        case BC_CONVERT_F64_I64:
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, convertI64ToF64(t64_1));
-            assert(result);
-            break;
-        case BC_CONVERT_F64_U32:
-            result = ntPop32(vm, &t32_1);
-            assert(result);
-            result = ntPush64(vm, convertU32ToF64(t32_1));
-            assert(result);
-            break;
-        case BC_CONVERT_F64_U64:
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, convertU64ToF64(t64_1));
-            assert(result);
-            break;
-        case BC_CONVERT_I32_STR: {
+            VM_BREAK;
+        VM_CASE(CONVERT_I32_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush32(vm, ntStringToI32(str));
+            result = stackPush32(vm, ntStringToI32(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_U32_STR: {
+        VM_CASE(CONVERT_U32_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush32(vm, ntStringToU32(str));
+            result = stackPush32(vm, ntStringToU32(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_I64_STR: {
+        VM_CASE(CONVERT_I64_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush64(vm, ntStringToI64(str));
+            result = stackPush64(vm, ntStringToI64(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_U64_STR: {
+        VM_CASE(CONVERT_U64_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush64(vm, ntStringToU64(str));
+            result = stackPush64(vm, ntStringToU64(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_F32_STR: {
+        VM_CASE(CONVERT_F32_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush32(vm, ntStringToF32(str));
+            result = stackPush32(vm, ntStringToF32(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_F64_STR: {
+        VM_CASE(CONVERT_F64_STR) {
             const NT_STRING *str;
-            result = ntPopRef(vm, (NT_REF *)&str);
+            result = stackPopRef(vm, (NT_REF *)&str);
             assert(result);
-            result = ntPush64(vm, ntStringToF64(str));
+            result = stackPush64(vm, ntStringToF64(str));
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_I32: {
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(CONVERT_STR_I32) {
+            result = stackPop32(vm, &t32_1);
             assert(result);
 
             const NT_TYPE *const type = ntI32Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t32_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_U32: {
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(CONVERT_STR_U32) {
+            result = stackPop32(vm, &t32_1);
             assert(result);
 
             const NT_TYPE *const type = ntU32Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t32_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_I64: {
-            result = ntPop64(vm, &t64_1);
+        VM_CASE(CONVERT_STR_I64) {
+            result = stackPop64(vm, &t64_1);
             assert(result);
 
             const NT_TYPE *const type = ntI64Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t64_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_U64: {
-            result = ntPop64(vm, &t64_1);
+        VM_CASE(CONVERT_STR_U64) {
+            result = stackPop64(vm, &t64_1);
             assert(result);
 
             const NT_TYPE *const type = ntU64Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t64_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_F32: {
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(CONVERT_STR_F32) {
+            result = stackPop32(vm, &t32_1);
             assert(result);
 
             const NT_TYPE *const type = ntF32Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t32_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_CONVERT_STR_F64: {
-            result = ntPop64(vm, &t64_1);
+        VM_CASE(CONVERT_STR_F64) {
+            result = stackPop64(vm, &t64_1);
             assert(result);
 
             const NT_TYPE *const type = ntF64Type();
             const NT_STRING *const str = type->string((NT_OBJECT *)&t64_1);
-            result = ntPushRef(vm, (NT_REF)str);
+            result = stackPushRef(vm, (NT_REF)str);
             assert(result);
-            break;
+            VM_BREAK;
         }
-        case BC_TRUNCATE_I32_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CASE(TRUNCATE_I32_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, truncateFloatToI32(t32_1));
+        VM_CACHED_CASE(TRUNCATE_I32_F32)
+            t32_1 = top;
+            top = truncateFloatToI32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(TRUNCATE_I64_F32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_TRUNCATE_I64_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, truncateFloatToI64(t32_1));
             assert(result);
-            result = ntPush64(vm, truncateFloatToI64(t32_1));
+            VM_BREAK;
+        VM_CASE(TRUNCATE_U32_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_TRUNCATE_U32_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(TRUNCATE_U32_F32)
+            t32_1 = top;
+            top = truncateFloatToU32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(TRUNCATE_U64_F32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, truncateFloatToU32(t32_1));
+            result = stackPush64(vm, truncateFloatToU64(t32_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_U64_F32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(TRUNCATE_I32_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, truncateFloatToU64(t32_1));
+            result = stackPush32(vm, truncateDoubleToI32(t64_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_I32_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(TRUNCATE_I64_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, truncateDoubleToI32(t64_1));
+            result = stackPush64(vm, truncateDoubleToI64(t64_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_I64_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(TRUNCATE_U32_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, truncateDoubleToI64(t64_1));
+            result = stackPush32(vm, truncateDoubleToU32(t64_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_U32_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(TRUNCATE_U64_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, truncateDoubleToU32(t64_1));
+            result = stackPush64(vm, truncateDoubleToU64(t64_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_U64_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(MIN_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, truncateDoubleToU64(t64_1));
+        VM_CACHED_CASE(MIN_F32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            break;
-        case BC_MIN_F32:
-            result = ntPop32(vm, &t32_1);
+            top = minF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(MIN_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, minF32(t32_1, t32_2));
+            result = stackPush64(vm, minF64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_MIN_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(MAX_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(MAX_F32)
+            t32_1 = top;
+            result = stackPop32(vm, &t32_2);
             assert(result);
-            result = ntPush64(vm, minF64(t64_1, t64_2));
+            top = maxF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(MAX_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_MAX_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_2);
+            result = stackPush64(vm, maxF64(t64_1, t64_2));
             assert(result);
-            result = ntPush32(vm, maxF32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(NEAREST_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_MAX_F64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(NEAREST_F32)
+            t32_1 = top;
+            top = nearestF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(NEAREST_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, nearestF64(t64_1));
             assert(result);
-            result = ntPush64(vm, maxF64(t64_1, t64_2));
+            VM_BREAK;
+        VM_CASE(CEIL_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_NEAREST_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(CEIL_F32)
+            t32_1 = top;
+            top = ceilF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(CEIL_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, nearestF32(t32_1));
+            result = stackPush64(vm, ceilF64(t64_1));
             assert(result);
-            break;
-        case BC_NEAREST_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(FLOOR_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, nearestF64(t64_1));
+        VM_CACHED_CASE(FLOOR_F32)
+            t32_1 = top;
+            top = floorF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(FLOOR_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_CEIL_F32:
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, floorF64(t64_1));
             assert(result);
-            result = ntPush32(vm, ceilF32(t32_1));
+            VM_BREAK;
+        VM_CASE(TRUNCATE_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_CEIL_F64:
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(TRUNCATE_F32)
+            t32_1 = top;
+            top = truncateF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(TRUNCATE_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, ceilF64(t64_1));
+            result = stackPush64(vm, truncateF64(t64_1));
             assert(result);
-            break;
-        case BC_FLOOR_F32:
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(ABS_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, floorF32(t32_1));
+        VM_CACHED_CASE(ABS_F32)
+            t32_1 = top;
+            top = absF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(ABS_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_FLOOR_F64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, absF64(t64_1));
             assert(result);
-            result = ntPush64(vm, floorF64(t64_1));
+            VM_BREAK;
+        VM_CASE(SQRT_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_TRUNCATE_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(SQRT_F32)
+            t32_1 = top;
+            top = sqrtF32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(SQRT_F64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, truncateF32(t32_1));
+            result = stackPush64(vm, sqrtF64(t64_1));
             assert(result);
-            break;
-        case BC_TRUNCATE_F64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(COPYSIGN_F32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, truncateF64(t64_1));
+        VM_CACHED_CASE(COPYSIGN_F32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_ABS_F32:
-            result = ntPop32(vm, &t32_1);
+            top = copysignF32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(COPYSIGN_F64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, absF32(t32_1));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_ABS_F64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, copysignF64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, absF64(t64_1));
+            VM_BREAK;
+        VM_CASE(AND_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_SQRT_F32:
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(AND_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, sqrtF32(t32_1));
+            top = and32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(AND_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_SQRT_F64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, sqrtF64(t64_1));
+            result = stackPush64(vm, and64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_COPYSIGN_F32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(OR_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(OR_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, copysignF32(t32_1, t32_2));
+            top = or32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(OR_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_COPYSIGN_F64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, or64(t64_1, t64_2));
             assert(result);
-            result = ntPush64(vm, copysignF64(t64_1, t64_2));
+            VM_BREAK;
+        VM_CASE(XOR_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_AND_I32:
-            result = ntPop32(vm, &t32_2);
+        VM_CACHED_CASE(XOR_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            top = xor32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(XOR_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush32(vm, and32(t32_1, t32_2));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_AND_I64:
-            result = ntPop64(vm, &t64_2);
+            result = stackPush64(vm, xor64(t64_1, t64_2));
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(SHL_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush64(vm, and64(t64_1, t64_2));
+        VM_CACHED_CASE(SHL_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_OR_I32:
-            result = ntPop32(vm, &t32_2);
+            top = shl32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SHL_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, or32(t32_1, t32_2));
+            result = stackPush64(vm, shl64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_OR_I64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(SHR_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(SHR_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush64(vm, or64(t64_1, t64_2));
+            top = shrS32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SHR_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_XOR_I32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPush64(vm, shrS64(t64_1, t64_2));
             assert(result);
-            result = ntPush32(vm, xor32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(SHR_U32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_XOR_I64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(SHR_U32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            top = shrU32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SHR_U64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPush64(vm, xor64(t64_1, t64_2));
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            break;
-        case BC_SHL_I32:
-            result = ntPop32(vm, &t32_2);
+            result = stackPush64(vm, shrU64(t64_1, t64_2));
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CASE(ROL_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPush32(vm, shl32(t32_1, t32_2));
+        VM_CACHED_CASE(ROL_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            break;
-        case BC_SHL_I64:
-            result = ntPop64(vm, &t64_2);
+            top = rol32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(ROL_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, shl64(t64_1, t64_2));
+            result = stackPush64(vm, rol64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_SHR_I32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(ROR_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(ROR_I32)
+            t32_2 = top;
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPush32(vm, shrS32(t32_1, t32_2));
+            top = ror32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(ROR_I64)
+            result = stackPop64(vm, &t64_2);
             assert(result);
-            break;
-        case BC_SHR_I64:
-            result = ntPop64(vm, &t64_2);
-            assert(result);
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, shrS64(t64_1, t64_2));
-            assert(result);
-            break;
-        case BC_SHR_U32:
-            result = ntPop32(vm, &t32_2);
-            assert(result);
-            result = ntPop32(vm, &t32_1);
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, shrU32(t32_1, t32_2));
+            result = stackPush64(vm, ror64(t64_1, t64_2));
             assert(result);
-            break;
-        case BC_SHR_U64:
-            result = ntPop64(vm, &t64_2);
-            assert(result);
-            result = ntPop64(vm, &t64_1);
-            assert(result);
-            result = ntPush64(vm, shrU64(t64_1, t64_2));
-            assert(result);
-            break;
-        case BC_ROL_I32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(CLZ_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+        VM_CACHED_CASE(CLZ_I32)
+            t32_1 = top;
+            top = clz32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(CLZ_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, rol32(t32_1, t32_2));
+            result = stackPush64(vm, clz64(t64_1));
             assert(result);
-            break;
-        case BC_ROL_I64:
-            result = ntPop64(vm, &t64_2);
+            VM_BREAK;
+        VM_CASE(CTZ_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+        VM_CACHED_CASE(CTZ_I32)
+            t32_1 = top;
+            top = ctz32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(CTZ_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush64(vm, rol64(t64_1, t64_2));
+            result = stackPush64(vm, ctz64(t64_1));
             assert(result);
-            break;
-        case BC_ROR_I32:
-            result = ntPop32(vm, &t32_2);
+            VM_BREAK;
+        VM_CASE(POP)
+            stackPop(vm, NULL, instruction->operand);
+            VM_BREAK;
+        VM_CASE(POP_32)
+            result = stackPop32(vm, &t32_1);
             assert(result);
-            result = ntPop32(vm, &t32_1);
+            VM_BREAK;
+        VM_CACHED_CASE(POP_32)
+            VM_BREAK;
+        VM_CASE(POP_64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPush32(vm, ror32(t32_1, t32_2));
+            VM_BREAK;
+        VM_CASE(POPCNT_I32)
+            result = stackPop32(vm, &top);
             assert(result);
-            break;
-        case BC_ROR_I64:
-            result = ntPop64(vm, &t64_2);
+        VM_CACHED_CASE(POPCNT_I32)
+            t32_1 = top;
+            top = popcount32(t32_1);
+            VM_BREAK_CACHED;
+        VM_CASE(POPCNT_I64)
+            result = stackPop64(vm, &t64_1);
             assert(result);
-            result = ntPop64(vm, &t64_1);
+            result = stackPush64(vm, popcount64(t64_1));
             assert(result);
-            result = ntPush64(vm, ror64(t64_1, t64_2));
+            VM_BREAK;
+
+        VM_CASE(CALL) {
+            VM_CHARGE();
+            const NT_DELEGATE *delegate = NULL;
+            result = stackPopRef(vm, (NT_REF *)&delegate);
             assert(result);
-            break;
-        case BC_CLZ_I32:
-            result = ntPop32(vm, &t32_1);
+            // a native fails for the program, like a join on a task joined already
+            if (!ntCall(vm, delegate))
+                return vm->stackOverflow ? NT_STACK_OVERFLOW : NT_RUNTIME_ERROR;
+            VM_BREAK;
+        }
+        VM_CASE(RETURN)
+            result = returnCall(vm);
             assert(result);
-            result = ntPush32(vm, clz32(t32_1));
+            VM_BREAK;
+        VM_CASE(HALT)
+            return NT_OK;
+
+        VM_CASE(CALL_DIRECT) {
+            VM_CHARGE();
+            // the target was checked when the module was translated
+            const NT_DELEGATE *delegate = (const NT_DELEGATE *)instruction->object;
+            TRACE_CALL(delegate);
+            result = delegate->native ? callNative(vm, delegate) : callFunction(vm, delegate, false);
+            if (!result)
+                return vm->stackOverflow ? NT_STACK_OVERFLOW : NT_RUNTIME_ERROR;
+            VM_BREAK;
+        }
+        VM_CASE(TAIL_CALL) {
+            VM_CHARGE();
+            const NT_DELEGATE *delegate = (const NT_DELEGATE *)instruction->object;
+            TRACE_CALL(delegate);
+            result = slideArguments(vm, delegate->paramsSize, instruction->operand);
+            assert(result);
+            result = callFunction(vm, delegate, true);
+            if (!result)
+                return vm->stackOverflow ? NT_STACK_OVERFLOW : NT_RUNTIME_ERROR;
+            VM_BREAK;
+        }
+        VM_CASE(RETURN_32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), 0);
             assert(result);
-            break;
-        case BC_CLZ_I64:
-            result = ntPop64(vm, &t64_1);
+            result = ntWriteSp(vm, &t32_1, sizeof(uint32_t), instruction->operand);
             assert(result);
-            result = ntPush64(vm, clz64(t64_1));
+            result = stackPop(vm, NULL, instruction->value32);
             assert(result);
-            break;
-        case BC_CTZ_I32:
-            result = ntPop32(vm, &t32_1);
+            result = returnCall(vm);
             assert(result);
-            result = ntPush32(vm, ctz32(t32_1));
+            VM_BREAK;
+        VM_CASE(RETURN_64)
+            result = stackPeek(vm, &t64_1, sizeof(uint64_t), 0);
             assert(result);
-            break;
-        case BC_CTZ_I64:
-            result = ntPop64(vm, &t64_1);
+            result = ntWriteSp(vm, &t64_1, sizeof(uint64_t), instruction->operand);
             assert(result);
-            result = ntPush64(vm, ctz64(t64_1));
+            result = stackPop(vm, NULL, instruction->value32);
             assert(result);
-            break;
-        case BC_POP:
-            vm->pc += ntReadVariant(vm->module, vm->pc, &t64_1);
-            ntPop(vm, NULL, sizeof(uint32_t) * t64_1);
-            break;
-        case BC_POP_32:
-            result = ntPop32(vm, &t32_1);
+            result = returnCall(vm);
             assert(result);
-            break;
-        case BC_POP_64:
-            result = ntPop64(vm, &t64_1);
+            VM_BREAK;
+        VM_CASE(POP_RETURN)
+            result = stackPop(vm, NULL, instruction->operand);
             assert(result);
-            break;
-        case BC_POPCNT_I32:
-            result = ntPop32(vm, &t32_1);
+            result = returnCall(vm);
             assert(result);
-            result = ntPush32(vm, popcount32(t32_1));
+            VM_BREAK;
+        VM_CASE(ADD_SP_SP_I32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), instruction->operand);
             assert(result);
-            break;
-        case BC_POPCNT_I64:
-            result = ntPop64(vm, &t64_1);
+            result = stackPeek(vm, &t32_2, sizeof(uint32_t), instruction->value32);
             assert(result);
-            result = ntPush64(vm, popcount64(t64_1));
+            top = add32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CACHED_CASE(ADD_SP_SP_I32)
+            result = peekCached32(vm, &t32_1, instruction->operand, top);
+            assert(result);
+            result = peekCached32(vm, &t32_2, instruction->value32, top);
+            assert(result);
+            result = stackPush32(vm, top);
+            assert(result);
+            top = add32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(SUB_SP_SP_I32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), instruction->operand);
+            assert(result);
+            result = stackPeek(vm, &t32_2, sizeof(uint32_t), instruction->value32);
+            assert(result);
+            top = sub32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CACHED_CASE(SUB_SP_SP_I32)
+            result = peekCached32(vm, &t32_1, instruction->operand, top);
+            assert(result);
+            result = peekCached32(vm, &t32_2, instruction->value32, top);
+            assert(result);
+            result = stackPush32(vm, top);
+            assert(result);
+            top = sub32(t32_1, t32_2);
+            VM_BREAK_CACHED;
+        VM_CASE(ADD_SP_CONST_I32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), instruction->operand);
+            assert(result);
+            top = add32(t32_1, instruction->value32);
+            VM_BREAK_CACHED;
+        VM_CACHED_CASE(ADD_SP_CONST_I32)
+            result = peekCached32(vm, &t32_1, instruction->operand, top);
+            assert(result);
+            result = stackPush32(vm, top);
+            assert(result);
+            top = add32(t32_1, instruction->value32);
+            VM_BREAK_CACHED;
+        VM_CASE(SUB_SP_CONST_I32)
+            result = stackPeek(vm, &t32_1, sizeof(uint32_t), instruction->operand);
+            assert(result);
+            top = sub32(t32_1, instruction->value32);
+            VM_BREAK_CACHED;
+        VM_CACHED_CASE(SUB_SP_CONST_I32)
+            result = peekCached32(vm, &t32_1, instruction->operand, top);
+            assert(result);
+            result = stackPush32(vm, top);
+            assert(result);
+            top = sub32(t32_1, instruction->value32);
+            VM_BREAK_CACHED;
+
+// comparison that leaves its result on the stack, like BRANCH_Z_32 expects, then branches on it
+#define VM_COMPARE_BRANCH_Z(op, type, operator)                                                    \
+    VM_CASE(op)                                                                                    \
+    result = stackPop32(vm, &top);                                                                    \
+    assert(result);                                                                                \
+    VM_CACHED_CASE(op)                                                                             \
+    t32_2 = top;                                                                                   \
+    result = stackPop32(vm, &t32_1);                                                                  \
+    assert(result);                                                                                \
+    top = *(type *)&t32_1 operator*(type *)&t32_2;                                                 \
+    if (top == 0)                                                                                  \
+        vm->pc = instruction->target;                                                              \
+    VM_TRACE_BRANCH(top == 0);                                                                     \
+    VM_BREAK_CACHED;
+
+        VM_COMPARE_BRANCH_Z(EQ_32_BRANCH_Z, uint32_t, ==)
+        VM_COMPARE_BRANCH_Z(NE_32_BRANCH_Z, uint32_t, !=)
+        VM_COMPARE_BRANCH_Z(GT_I32_BRANCH_Z, int32_t, >)
+        VM_COMPARE_BRANCH_Z(GT_U32_BRANCH_Z, uint32_t, >)
+        VM_COMPARE_BRANCH_Z(LT_I32_BRANCH_Z, int32_t, <)
+        VM_COMPARE_BRANCH_Z(LT_U32_BRANCH_Z, uint32_t, <)
+        VM_COMPARE_BRANCH_Z(GE_I32_BRANCH_Z, int32_t, >=)
+        VM_COMPARE_BRANCH_Z(GE_U32_BRANCH_Z, uint32_t, >=)
+        VM_COMPARE_BRANCH_Z(LE_I32_BRANCH_Z, int32_t, <=)
+        VM_COMPARE_BRANCH_Z(LE_U32_BRANCH_Z, uint32_t, <=)
+#undef VM_COMPARE_BRANCH_Z
+
+        // register instructions address slots relative to the stack top they started from
+        VM_CASE(REG_ADJUST)
+            result = adjustStack(vm, instruction->delta);
+            assert(result);
+            VM_BREAK;
+        VM_CASE(REG_MOVE_32)
+            frame = vm->stackTop;
+            t32_1 = readSlot32(frame + instruction->left);
+            result = adjustStack(vm, instruction->delta);
+            assert(result);
+            writeSlot32(frame + instruction->dst, t32_1);
+            VM_BREAK;
+        VM_CASE(REG_MOVE_32_K)
+            frame = vm->stackTop;
+            result = adjustStack(vm, instruction->delta);
+            assert(result);
+            writeSlot32(frame + instruction->dst, (uint32_t)instruction->right);
+            VM_BREAK;
+
+#define VM_REGISTER_BINARY(op, expression)                                                         \
+    VM_CASE(REG_##op)                                                                              \
+    frame = vm->stackTop;                                                                          \
+    t32_1 = readSlot32(frame + instruction->left);                                                 \
+    t32_2 = readSlot32(frame + instruction->right);                                                \
+    result = adjustStack(vm, instruction->delta);                                                  \
+    assert(result);                                                                                \
+    writeSlot32(frame + instruction->dst, (expression));                                           \
+    VM_BREAK;                                                                                      \
+    VM_CASE(REG_##op##_K)                                                                          \
+    frame = vm->stackTop;                                                                          \
+    t32_1 = readSlot32(frame + instruction->left);                                                 \
+    t32_2 = (uint32_t)instruction->right;                                                          \
+    result = adjustStack(vm, instruction->delta);                                                  \
+    assert(result);                                                                                \
+    writeSlot32(frame + instruction->dst, (expression));                                           \
+    VM_BREAK;
+
+        VM_REGISTER_BINARY(ADD_I32, add32(t32_1, t32_2))
+        VM_REGISTER_BINARY(SUB_I32, sub32(t32_1, t32_2))
+        VM_REGISTER_BINARY(MUL_I32, mul32(t32_1, t32_2))
+        VM_REGISTER_BINARY(EQ_32, t32_1 == t32_2)
+        VM_REGISTER_BINARY(NE_32, t32_1 != t32_2)
+        VM_REGISTER_BINARY(GT_I32, *(int32_t *)&t32_1 > *(int32_t *)&t32_2)
+        VM_REGISTER_BINARY(GT_U32, t32_1 > t32_2)
+        VM_REGISTER_BINARY(LT_I32, *(int32_t *)&t32_1 < *(int32_t *)&t32_2)
+        VM_REGISTER_BINARY(LT_U32, t32_1 < t32_2)
+        VM_REGISTER_BINARY(GE_I32, *(int32_t *)&t32_1 >= *(int32_t *)&t32_2)
+        VM_REGISTER_BINARY(GE_U32, t32_1 >= t32_2)
+        VM_REGISTER_BINARY(LE_I32, *(int32_t *)&t32_1 <= *(int32_t *)&t32_2)
+        VM_REGISTER_BINARY(LE_U32, t32_1 <= t32_2)
+#undef VM_REGISTER_BINARY
+
+#ifdef NT_THREADED_DISPATCH
+        // entries of the cached table for instructions that expect the whole stack in memory
+#define bytecode(a)                                                                                \
+    SPILL_##a : result = stackPush32(vm, top);                                                        \
+    assert(result);                                                                                \
+    cached = false;                                                                                \
+    goto OP_##a;
+#include <netuno/opcode.inc>
+#undef bytecode
+        SPILL_UNKNOWN:
+            result = stackPush32(vm, top);
+            assert(result);
+            cached = false;
+            goto OP_UNKNOWN;
+
+        LOG_INSTRUCTION:
+            ntLogInstruction(vm->traceLog, vm->module, instruction, vm->stackTop - vm->stack);
+            goto *dispatchTable[instruction->opcode];
+        LOG_CACHED_INSTRUCTION:
+            ntLogInstruction(vm->traceLog, vm->module, instruction,
+                             vm->stackTop - vm->stack + sizeof(uint32_t));
+            goto *cachedTable[instruction->opcode];
+#else
+        default:
+            if (!cached)
+                goto unknown;
+            result = stackPush32(vm, top);
             assert(result);
+            cached = false;
+            vm->pc = instruction;
             break;
+#endif
 
-        case BC_CALL: {
-            const NT_DELEGATE *delegate = NULL;
-            result = ntPopRef(vm, (NT_REF *)&delegate);
-            assert(result);
-            result = ntCall(vm, delegate);
-            assert(result);
-            break;
-        }
-        case BC_RETURN: {
-            RETURN_ADR tmp;
-            result = popCall(vm, &tmp);
-            assert(result);
-            vm->module = tmp.module;
-            vm->pc = tmp.pc;
-            break;
+        VM_DEFAULT
+            printf("Unsupported opcode %d.\n", instruction->opcode);
+            VM_BREAK;
         }
-        default:
-            printf("Unsupported opcode %d.\n", instruction);
-            break;
+    }
+}
+#ifdef NT_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+bool ntInvoke(NT_VM *vm, const NT_DELEGATE *delegate)
+{
+    // the native stack cannot grow like the VM stacks
+    if (vm->invokeDepth == vm->invokeLimit)
+    {
+        vm->stackOverflow = true;
+        return false;
+    }
+    vm->invokeDepth++;
+
+    const NT_INSTRUCTION *pc = vm->pc;
+    const NT_MODULE *module = vm->module;
+
+    // the callee returns into HOST_MODULE, so a nested run stops when it does
+    moveTo(vm, &HOST_MODULE, HOST_MODULE.instructions);
+    INTERPRETING(true);
+    bool result = ntCall(vm, delegate);
+    if (result && vm->pc != HOST_MODULE.instructions)
+        result = run(vm) == NT_OK;
+    END_INTERPRETING();
+
+    moveTo(vm, module, pc);
+    vm->invokeDepth--;
+    return result;
+}
+
+size_t ntBacktrace(const NT_VM *vm, NT_FRAME *frames, size_t count)
+{
+    const sig_atomic_t sequence = vm->sequence;
+    if (sequence % 2 != 0 || count == 0)
+        return 0;
+    atomic_signal_fence(memory_order_seq_cst);
+
+    frames[0] = (NT_FRAME){.pc = vm->pc, .module = vm->module};
+    const RETURN_ADR *const bottom = (const RETURN_ADR *)vm->callStack;
+    const RETURN_ADR *frame = (const RETURN_ADR *)vm->callStackTop;
+    size_t i = 1;
+    while (i < count && frame > bottom)
+        frames[i++] = *--frame;
+
+    // a transition began meanwhile, which only a caller on another thread can see
+    atomic_signal_fence(memory_order_seq_cst);
+    return vm->sequence == sequence ? i : 0;
+}
+
+NT_FIBER *ntCreateFiber(const NT_VM_CONFIG *config, const NT_DELEGATE *entryPoint)
+{
+    assert(entryPoint);
+    if (!config)
+        config = &DEFAULT_CONFIG;
+
+    // the first resume swaps the stacks in, like for any suspended fiber
+    const size_t stackSize = config->stackSize ? config->stackSize : 1;
+    const size_t callStackSize = config->callStackSize ? config->callStackSize : 1;
+    NT_FIBER *fiber = (NT_FIBER *)ntMalloc(sizeof(NT_FIBER));
+    fiber->state = NT_FIBER_NEW;
+    fiber->entryPoint = entryPoint;
+    fiber->value = 0;
+    fiber->caller = NULL;
+    fiber->invokeDepth = 0;
+    fiber->module = &HOST_MODULE;
+    fiber->pc = HOST_MODULE.instructions;
+    fiber->stackLimit = config->stackLimit ? config->stackLimit : 1;
+    fiber->callStackLimit = config->callStackLimit ? config->callStackLimit : 1;
+    fiber->stack = ntMalloc(stackSize);
+    fiber->stackTop = fiber->stack;
+    fiber->stackEnd = fiber->stack + stackSize;
+    fiber->callStack = ntMalloc(callStackSize);
+    fiber->callStackTop = fiber->callStack;
+    fiber->callStackEnd = fiber->callStack + callStackSize;
+    fiber->guarded = false;
+    fiber->parked = false;
+#ifdef DEBUG_TRACE_EXECUTION
+    fiber->stackType = (size_t *)ntMalloc(sizeof(size_t) * stackSize);
+    fiber->stackTypeTop = fiber->stackType;
+#endif
+    return fiber;
+}
+
+void ntFreeFiber(NT_FIBER *fiber)
+{
+    // a running fiber holds the stacks of its caller
+    assert(fiber->state != NT_FIBER_RUNNING);
+#ifdef DEBUG_TRACE_EXECUTION
+    ntFree(fiber->stackType);
+#endif
+    ntFree(fiber->callStack);
+    ntFree(fiber->stack);
+    ntFree(fiber);
+}
+
+static void swapFiber(NT_VM *vm, NT_FIBER *fiber)
+{
+#define SWAP(type, field)                                                                          \
+    do                                                                                             \
+    {                                                                                              \
+        type swap = vm->field;                                                                     \
+        vm->field = fiber->field;                                                                  \
+        fiber->field = swap;                                                                       \
+    } while (0)
+
+    beginTransition(vm);
+    SWAP(const NT_MODULE *, module);
+    SWAP(const NT_INSTRUCTION *, pc);
+    SWAP(uint8_t *, stack);
+    SWAP(uint8_t *, stackTop);
+    SWAP(uint8_t *, stackEnd);
+    SWAP(size_t, stackLimit);
+    SWAP(uint8_t *, callStack);
+    SWAP(uint8_t *, callStackTop);
+    SWAP(uint8_t *, callStackEnd);
+    SWAP(size_t, callStackLimit);
+    SWAP(bool, guarded);
+#ifdef DEBUG_TRACE_EXECUTION
+    SWAP(size_t *, stackType);
+    SWAP(size_t *, stackTypeTop);
+#endif
+#undef SWAP
+    endTransition(vm);
+}
+
+bool ntResume(NT_VM *vm, NT_FIBER *fiber, const uint32_t value)
+{
+    assert(vm);
+    assert(fiber);
+    if ((fiber->state != NT_FIBER_NEW && fiber->state != NT_FIBER_SUSPENDED) || fiber->parked)
+        return false;
+
+    const NT_INSTRUCTION *pc = vm->pc;
+    const NT_MODULE *module = vm->module;
+    const NT_FIBER_STATE state = fiber->state;
+    fiber->state = NT_FIBER_RUNNING;
+    fiber->caller = vm->fiber;
+    fiber->invokeDepth = vm->invokeDepth;
+    swapFiber(vm, fiber);
+    vm->fiber = fiber;
+
+    // a new fiber returns into HOST_MODULE, and a suspended one gets the result of its yield
+    INTERPRETING(true);
+    bool result = ntPush32(vm, value);
+    if (result && state == NT_FIBER_NEW)
+        result = ntCall(vm, fiber->entryPoint);
+    if (result)
+        result = run(vm) == NT_OK;
+    END_INTERPRETING();
+
+    if (fiber->state == NT_FIBER_RUNNING)
+    {
+        // returned or failed, on its own stacks still
+        if (result)
+            result = ntPop32(vm, &fiber->value);
+        fiber->state = result ? NT_FIBER_DONE : NT_FIBER_FAILED;
+        swapFiber(vm, fiber);
+        vm->fiber = fiber->caller;
+    }
+
+    moveTo(vm, module, pc);
+    return result && ntPush32(vm, fiber->value);
+}
+
+bool ntYield(NT_VM *vm, const uint32_t value)
+{
+    assert(vm);
+    NT_FIBER *fiber = vm->fiber;
+    if (!fiber || vm->invokeDepth != fiber->invokeDepth)
+        return false;
+
+    fiber->value = value;
+    fiber->state = NT_FIBER_SUSPENDED;
+    swapFiber(vm, fiber);
+    vm->fiber = fiber->caller;
+
+    // ends the run of ntResume once the native returns
+    moveTo(vm, &HOST_MODULE, HOST_MODULE.instructions);
+    return true;
+}
+
+// entryPoint is NULL to go on where the run stopped
+static NT_RESULT start(NT_VM *vm, const NT_DELEGATE *entryPoint)
+{
+    if (entryPoint && !ntCall(vm, entryPoint))
+        return vm->stackOverflow ? NT_STACK_OVERFLOW : NT_RUNTIME_ERROR;
+    return run(vm);
+}
+
+#ifdef NT_GUARD_PAGES
+// Runs with the guards of the VM armed. The overflow unwinds every nested ntInvoke at once.
+static NT_RESULT startGuarded(NT_VM *vm, const NT_DELEGATE *entryPoint)
+{
+    if (!pthread_getspecific(signalStackKey))
+    {
+        stack_t stack = {.ss_sp = ntMalloc(SIGNAL_STACK_SIZE), .ss_size = SIGNAL_STACK_SIZE};
+        if (sigaltstack(&stack, NULL) != 0 || pthread_setspecific(signalStackKey, stack.ss_sp) != 0)
+        {
+            ntFree(stack.ss_sp);
+            return NT_RUNTIME_ERROR;
         }
+    }
 
-        if (vm->stackOverflow)
-            return NT_STACK_OVERFLOW;
+    GUARD_SCOPE scope = {.vm = vm};
+    GUARD_SCOPE *const outer = guardScope;
+    INTERPRETING(true);
+    if (sigsetjmp(scope.overflow, true))
+    {
+        guardScope = outer;
+        END_INTERPRETING();
+        vm->invokeDepth = 0;
+        return NT_STACK_OVERFLOW;
     }
+
+    guardScope = &scope;
+    const NT_RESULT result = start(vm, entryPoint);
+    guardScope = outer;
+    END_INTERPRETING();
+    return result;
 }
+#endif
 
 NT_RESULT ntRun(NT_VM *vm, NT_ASSEMBLY *assembly, const NT_DELEGATE *entryPoint)
 {
     assert(entryPoint);
-    vm->pc = SIZE_MAX;
-    vm->module = NULL;
+    // a frozen assembly may be running on other threads, and is translated already
+    if (!assembly->frozen && !ntTranslateAssembly(assembly))
+        return NT_RUNTIME_ERROR;
+
+    // the entry point returns into HOST_MODULE, whose BC_HALT hands control back to the host
+    moveTo(vm, &HOST_MODULE, HOST_MODULE.instructions);
     vm->assembly = assembly;
-    ntCall(vm, entryPoint);
-    return run(vm);
+#ifdef NT_GUARD_PAGES
+    if (vm->guarded)
+        return startGuarded(vm, entryPoint);
+#endif
+    return start(vm, entryPoint);
+}
+
+void ntSetFuel(NT_VM *vm, uint64_t fuel)
+{
+    vm->fuel = fuel;
+    if (fuel == NT_FUEL_UNLIMITED)
+        vm->interpret &= ~NT_INTERPRET_FUEL;
+    else
+        vm->interpret |= NT_INTERPRET_FUEL;
+}
+
+NT_RESULT ntContinue(NT_VM *vm)
+{
+    assert(vm->assembly);
+#ifdef NT_GUARD_PAGES
+    if (vm->guarded)
+        return startGuarded(vm, NULL);
+#endif
+    return start(vm, NULL);
 }
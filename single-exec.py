@@ -4,20 +4,26 @@ testdir = "./tests"
 runner = "./bin/ntc"
 
 def test(file):
+    # ntc options of a test, one line next to it
+    args = []
+    if os.path.exists(file + ".args"):
+        with open(file + ".args") as f:
+            args = f.read().split()
     try:
-        proc = subprocess.run([runner, file], capture_output=True, text=True, timeout=2)
+        proc = subprocess.run([runner] + args + [file], capture_output=True, text=True, timeout=2)
         outs = proc.stdout
         errs = proc.stderr
     except subprocess.TimeoutExpired as timeErr:
         outs = timeErr.stdout
         errs = timeErr.stderr
         return False
-    if proc.returncode != 0:
-        return False
-
     with open(file + ".expected") as f:
         expect = f.read()
 
+    # a run may only fail when its expected output ends with the error
+    if proc.returncode != 0 and not expect.endswith(("Runtime Error!\n", "Stack Overflow!\n")):
+        return False
+
     if expect != outs:
         return False
 
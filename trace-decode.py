@@ -0,0 +1,55 @@
+import os, struct, sys
+
+# decodes the trace log ntc writes with --trace into one instruction per line, oldest first:
+#   module:line  pc  OPCODE  depth
+
+here = os.path.dirname(os.path.abspath(__file__))
+opcodeFile = os.path.join(here, "ntr", "include", "netuno", "opcode.inc")
+
+
+def opcodeNames():
+    names = []
+    with open(opcodeFile) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith("bytecode(") and line.endswith(")"):
+                names.append(line[len("bytecode("):-1])
+    return names
+
+
+def read(f, fmt):
+    size = struct.calcsize(fmt)
+    data = f.read(size)
+    if len(data) != size:
+        raise EOFError("truncated trace log")
+    return struct.unpack(fmt, data)
+
+
+def decode(path, last):
+    names = opcodeNames()
+    with open(path, "rb") as f:
+        if f.read(8) != b"NTLOG001":
+            raise ValueError(f"{path} is not a trace log")
+
+        (moduleCount,) = read(f, "<I")
+        modules = []
+        for _ in range(moduleCount):
+            (length,) = read(f, "<I")
+            name = f.read(length).decode("utf-8")
+            modules.append(name if name else "<host>")
+
+        (count,) = read(f, "<Q")
+        skip = max(0, count - last) if last is not None else 0
+        f.seek(skip * 20, os.SEEK_CUR)
+        for _ in range(count - skip):
+            module, pc, line, depth, opcode = read(f, "<5I")
+            name = names[opcode] if opcode < len(names) else f"UNKNOWN_{opcode}"
+            where = f"{modules[module]}:{line}" if line else modules[module]
+            print(f"{where}\t{pc}\t{name}\t{depth}")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or len(sys.argv) > 3:
+        print(f"usage: {sys.argv[0]} <trace> [last entries]")
+        sys.exit(2)
+    decode(sys.argv[1], int(sys.argv[2]) if len(sys.argv) == 3 else None)